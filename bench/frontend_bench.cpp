@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------
+// FILE: frontend_bench.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Compares front-end (lex + parse) latency of the serial and the
+// pipelined lexer on a generated multi-megabyte MyPL program.
+// USAGE: frontend_bench [function-count] [runs]
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "lexer.h"
+#include "pipelined_lexer.h"
+#include "ast_parser.h"
+
+using namespace std;
+
+
+// generate a program with the given number of (non-trivial) functions
+string generate_program(int function_count)
+{
+  string s = "struct Node {int val, Node next}\n";
+  for (int i = 0; i < function_count; ++i) {
+    string n = to_string(i);
+    s += "int f" + n + "(int a, int b) {\n";
+    s += "  int x = a + b * 2 - (a - 1)\n";
+    s += "  Node nd = new Node\n";
+    s += "  nd.val = x\n";
+    s += "  for (int i = 0; i < 3; i = i + 1) {\n";
+    s += "    if ((x > 10) and (b < 5)) {x = x - 1} elseif (x == 3) {x = x + 2}"
+      " else {x = x * 1}\n";
+    s += "    while (x < 0) {x = x + 1}\n";
+    s += "  }\n";
+    s += "  string msg = concat(\"value: \", to_string(x))\n";
+    s += "  return x + nd.val\n";
+    s += "}\n";
+  }
+  s += "void main() {\n  print(f0(1, 2))\n}\n";
+  return s;
+}
+
+
+// time one front-end run (in milliseconds)
+double time_parse(const string& source, bool pipelined)
+{
+  stringstream in(source);
+  auto start = chrono::steady_clock::now();
+  Program p;
+  if (pipelined) {
+    PipelinedLexer tokens {Lexer(in)};
+    p = ASTParser(tokens).parse();
+  } else
+    p = ASTParser(Lexer(in)).parse();
+  auto end = chrono::steady_clock::now();
+  if (p.fun_defs.empty())
+    cerr << "unexpected empty program" << endl;
+  return chrono::duration<double, milli>(end - start).count();
+}
+
+
+// print the best and median of the given run times
+void report(const string& name, vector<double> times, double megabytes)
+{
+  sort(times.begin(), times.end());
+  double best = times.front();
+  double median = times[times.size() / 2];
+  cout << name << ": best " << best << " ms, median " << median
+       << " ms, " << (megabytes / (best / 1000)) << " MB/s" << endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int function_count = argc > 1 ? stoi(argv[1]) : 10000;
+  int runs = argc > 2 ? stoi(argv[2]) : 5;
+  string source = generate_program(function_count);
+  double megabytes = source.size() / (1024.0 * 1024.0);
+  cout << "input: " << function_count << " functions, " << megabytes
+       << " MB, " << runs << " runs" << endl;
+  vector<double> serial;
+  vector<double> pipelined;
+  // alternate the two so both see the same machine conditions
+  for (int i = 0; i < runs; ++i) {
+    serial.push_back(time_parse(source, false));
+    pipelined.push_back(time_parse(source, true));
+  }
+  report("serial   ", serial, megabytes);
+  report("pipelined", pipelined, megabytes);
+}
@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------
+// FILE: frontend_scaling_bench.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Google Benchmark throughput of each front-end phase (lexer,
+// parser, semantic checker, and code generator) on generated programs
+// of growing size, with the complexity of each phase fit to the size.
+// USAGE: frontend_scaling_bench [--max-functions=N] [benchmark flags]
+// (about 1 KB of source per function, so 262144 gives about 300 MB)
+//----------------------------------------------------------------------
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "program_generator.h"
+#include "lexer.h"
+#include "ast_parser.h"
+#include "semantic_checker.h"
+#include "code_generator.h"
+#include "vm.h"
+
+using namespace std;
+
+
+// the generated program with the given number of functions (made once)
+const string& source(int functions)
+{
+  static map<int, string> sources;
+  auto entry = sources.find(functions);
+  if (entry == sources.end()) {
+    ProgramGenerator::Config config;
+    config.functions = functions;
+    config.structs = 4;
+    config.classes = 4;
+    entry = sources.insert({functions, ProgramGenerator(config).generate()}).first;
+  }
+  return entry->second;
+}
+
+
+Program parse(const string& s)
+{
+  stringstream in(s);
+  return ASTParser(Lexer(in)).parse();
+}
+
+
+double seconds_since(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+void set_size(benchmark::State& state, const string& s)
+{
+  state.SetBytesProcessed(state.iterations() * s.size());
+  state.SetComplexityN(s.size());
+  state.counters["KB"] = s.size() / 1024.0;
+}
+
+
+void BM_Lexer(benchmark::State& state)
+{
+  const string& s = source(state.range(0));
+  for (auto _ : state) {
+    stringstream in(s);
+    Lexer lexer(in);
+    long tokens = 0;
+    while (lexer.next_token().type() != TokenType::EOS)
+      ++tokens;
+    benchmark::DoNotOptimize(tokens);
+  }
+  set_size(state, s);
+}
+
+
+// the parser pulls its tokens from the lexer, so this is lexing plus
+// parsing (subtract BM_Lexer for the parser alone)
+void BM_ASTParser(benchmark::State& state)
+{
+  const string& s = source(state.range(0));
+  for (auto _ : state) {
+    auto start = chrono::steady_clock::now();
+    Program p = parse(s);
+    state.SetIterationTime(seconds_since(start));
+  }
+  set_size(state, s);
+}
+
+
+void BM_SemanticChecker(benchmark::State& state)
+{
+  const string& s = source(state.range(0));
+  for (auto _ : state) {
+    Program p = parse(s);
+    auto start = chrono::steady_clock::now();
+    SemanticChecker checker;
+    p.accept(checker);
+    state.SetIterationTime(seconds_since(start));
+  }
+  set_size(state, s);
+}
+
+
+void BM_CodeGenerator(benchmark::State& state)
+{
+  const string& s = source(state.range(0));
+  for (auto _ : state) {
+    Program p = parse(s);
+    SemanticChecker checker;
+    p.accept(checker);
+    VM vm;
+    auto start = chrono::steady_clock::now();
+    CodeGenerator generator(vm);
+    p.accept(generator);
+    state.SetIterationTime(seconds_since(start));
+  }
+  set_size(state, s);
+}
+
+
+int main(int argc, char* argv[])
+{
+  // take out our own option before the library sees the args
+  long max_functions = 4096;
+  vector<char*> args;
+  for (int i = 0; i < argc; ++i) {
+    if (strncmp(argv[i], "--max-functions=", 16) == 0)
+      max_functions = stol(argv[i] + 16);
+    else
+      args.push_back(argv[i]);
+  }
+  int arg_count = args.size();
+
+  // the Program (and its arena) is freed outside the measured time
+  using Phase = void (*)(benchmark::State&);
+  vector<pair<string, Phase>> phases {
+    {"Lexer", BM_Lexer}, {"ASTParser", BM_ASTParser},
+    {"SemanticChecker", BM_SemanticChecker},
+    {"CodeGenerator", BM_CodeGenerator}};
+  for (auto [name, f] : phases) {
+    auto* b = benchmark::RegisterBenchmark(name.c_str(), f);
+    b->RangeMultiplier(8)->Range(1, max_functions)->Complexity()
+      ->Unit(benchmark::kMillisecond);
+    if (f != BM_Lexer)
+      b->UseManualTime();
+  }
+
+  benchmark::Initialize(&arg_count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(arg_count, args.data()))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
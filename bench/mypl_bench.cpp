@@ -0,0 +1,334 @@
+//----------------------------------------------------------------------
+// FILE: mypl_bench.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Runs each bench/programs MyPL program through the full
+// pipeline (lex, parse, check, tree shake, code generation, and run),
+// printing the median time, instruction count, and peak RSS of each
+// and writing them as JSON for comparing builds. The output of each
+// program's counted run must match its expected output (the
+// program's .out file), so a miscompiling build fails instead of
+// reporting timings. Where the machine
+// allows, hardware counters (cycles, instructions, branch, cache, and
+// TLB misses) are read around each timed VM run, giving the IPC and the
+// branch misses per MyPL instruction.
+// USAGE: mypl_bench [runs] [results-file] [programs-dir]
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "lexer.h"
+#include "ast_parser.h"
+#include "semantic_checker.h"
+#include "tree_shaker.h"
+#include "code_generator.h"
+#include "vm.h"
+#include "run_stats.h"
+#include "mypl_exception.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+
+class BenchResult
+{
+public:
+  string name;
+  vector<double> times;         // milliseconds, one per run
+  long instructions = 0;
+  long calls = 0;
+  long peak_rss_kb = 0;         // 0 if not measured
+  // hardware counts per run of the VM (-1 if not available)
+  array<double, PerfCounters::COUNTER_COUNT> counters;
+  string error;                 // the first error (if any)
+};
+
+
+// compile and run a program, returning its output, adding the stats
+// profiler (if given) to the run and counting hardware events of the
+// run (if given)
+string run_program(const string& source, VMStats* stats = nullptr,
+                 PerfCounters* counters = nullptr)
+{
+  stringstream in(source);
+  ostringstream out;
+  streambuf* old_out = cout.rdbuf(out.rdbuf());
+  try {
+    VM vm;
+    {
+      Program p = ASTParser(Lexer(in)).parse();
+      SemanticChecker checker;
+      p.accept(checker);
+      TreeShaker shaker;
+      p.accept(shaker);
+      CodeGenerator generator(vm);
+      p.accept(generator);
+    }
+    if (stats)
+      vm.add_profiler(*stats);
+    if (counters)
+      counters->start();
+    vm.run();
+    if (counters)
+      counters->stop();
+  } catch (...) {
+    if (counters)
+      counters->stop();
+    cout.rdbuf(old_out);
+    throw;
+  }
+  cout.rdbuf(old_out);
+  return out.str();
+}
+
+
+// the peak resident set size (in KB) of one run in a child process (0
+// if it cannot be measured)
+long peak_rss(const string& source)
+{
+  pid_t child = fork();
+  if (child < 0)
+    return 0;
+  if (child == 0) {
+    try {
+      run_program(source);
+    } catch (...) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  int status = 0;
+  rusage usage {};
+  if (wait4(child, &status, 0, &usage) != child or !WIFEXITED(status) or
+      WEXITSTATUS(status) != 0)
+    return 0;
+  // kilobytes on Linux
+  return usage.ru_maxrss;
+}
+
+
+string read_file(const filesystem::path& path)
+{
+  ifstream in(path);
+  stringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+
+double median(vector<double> xs)
+{
+  if (xs.empty())
+    return 0;
+  sort(xs.begin(), xs.end());
+  int n = xs.size();
+  return n % 2 ? xs[n / 2] : (xs[n / 2 - 1] + xs[n / 2]) / 2;
+}
+
+
+// the instructions per cycle and branch misses per MyPL instruction
+// of a result (-1 if not known)
+double ipc(const BenchResult& r)
+{
+  double cycles = r.counters[PerfCounters::CYCLES];
+  double instructions = r.counters[PerfCounters::INSTRUCTIONS];
+  return cycles > 0 and instructions >= 0 ? instructions / cycles : -1;
+}
+
+double branch_misses_per_instruction(const BenchResult& r)
+{
+  double misses = r.counters[PerfCounters::BRANCH_MISSES];
+  return misses >= 0 and r.instructions > 0 ? misses / r.instructions : -1;
+}
+
+
+// a value for the JSON output (null if not known)
+string json_value(double x)
+{
+  if (x < 0)
+    return "null";
+  ostringstream s;
+  s << fixed << setprecision(3) << x;
+  return s.str();
+}
+
+
+void write_json(ostream& out, const vector<BenchResult>& results, int runs,
+                const PerfCounters& counters)
+{
+  // names are file stems of the bench programs and errors are from
+  // strerror (nothing to escape)
+  out << "{\"timestamp\": " << time(nullptr) << ", \"runs\": " << runs
+      << ", \"counters_available\": "
+      << (counters.any_available() ? "true" : "false");
+  if (!counters.error().empty())
+    out << ", \"counters_error\": \"" << counters.error() << "\"";
+  out << ", \"programs\": [";
+  out << fixed << setprecision(3);
+  for (int i = 0; i < results.size(); ++i) {
+    const BenchResult& r = results[i];
+    out << (i ? "," : "") << "\n  {\"name\": \"" << r.name << "\"";
+    if (!r.error.empty()) {
+      out << ", \"error\": true}";
+      continue;
+    }
+    auto [min_time, max_time] = minmax_element(r.times.begin(), r.times.end());
+    out << ", \"median_ms\": " << median(r.times) << ", \"min_ms\": "
+        << *min_time << ", \"max_ms\": " << *max_time
+        << ", \"instructions\": " << r.instructions << ", \"calls\": "
+        << r.calls << ", \"peak_rss_kb\": " << r.peak_rss_kb;
+    // hardware counts are per VM run
+    out << ", \"counters\": {";
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; ++c) {
+      out << (c ? ", " : "") << "\""
+          << PerfCounters::name(PerfCounters::Counter(c)) << "\": "
+          << json_value(r.counters[c]);
+    }
+    out << "}, \"ipc\": " << json_value(ipc(r))
+        << ", \"branch_misses_per_instruction\": "
+        << json_value(branch_misses_per_instruction(r)) << "}";
+  }
+  out << "\n]}" << endl;
+}
+
+
+// print the hardware counts per VM run of each program (with "-" for
+// those not available)
+void print_counters(const vector<BenchResult>& results)
+{
+  auto field = [](double x, int precision) {
+    ostringstream s;
+    if (x < 0)
+      s << "-";
+    else
+      s << fixed << setprecision(precision) << x;
+    return s.str();
+  };
+  cout << endl << "hardware counters per VM run:" << endl;
+  cout << left << setw(16) << "program" << right;
+  for (int c = 0; c < PerfCounters::COUNTER_COUNT; ++c)
+    cout << setw(14) << PerfCounters::name(PerfCounters::Counter(c));
+  cout << setw(8) << "IPC" << setw(16) << "br_miss/instr" << endl;
+  for (const BenchResult& r : results) {
+    if (!r.error.empty())
+      continue;
+    cout << left << setw(16) << r.name << right;
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; ++c)
+      cout << setw(14) << field(r.counters[c], 0);
+    cout << setw(8) << field(ipc(r), 2) << setw(16)
+         << field(branch_misses_per_instruction(r), 3) << endl;
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  int runs = argc > 1 ? max(1, stoi(argv[1])) : 5;
+  string results_file = argc > 2 ? argv[2] : "mypl_bench.json";
+  filesystem::path dir = argc > 3 ? argv[3] : MYPL_BENCH_PROGRAMS;
+
+  vector<filesystem::path> programs;
+  if (filesystem::is_directory(dir)) {
+    for (auto& entry : filesystem::directory_iterator(dir)) {
+      if (entry.path().extension() == ".mypl")
+        programs.push_back(entry.path());
+    }
+  }
+  sort(programs.begin(), programs.end());
+  if (programs.empty()) {
+    cerr << "no .mypl programs in " << dir << endl;
+    return 1;
+  }
+
+  vector<BenchResult> results(programs.size());
+  vector<string> sources;
+  vector<filesystem::path> expected_files;
+  for (int i = 0; i < programs.size(); ++i) {
+    results[i].name = programs[i].stem().string();
+    results[i].counters.fill(-1);
+    sources.push_back(read_file(programs[i]));
+    expected_files.push_back(
+      filesystem::path(programs[i]).replace_extension(".out"));
+  }
+
+  PerfCounters counters;
+  if (!counters.any_available())
+    cout << "hardware counters unavailable (" << counters.error() << ")"
+         << endl;
+  else if (!counters.error().empty())
+    cout << "some hardware counters unavailable (" << counters.error()
+         << ")" << endl;
+
+  // peak RSS first (each in a fresh child of this still small process)
+  for (int i = 0; i < programs.size(); ++i)
+    results[i].peak_rss_kb = peak_rss(sources[i]);
+
+  cout << left << setw(16) << "program" << right << setw(12) << "median ms"
+       << setw(12) << "min ms" << setw(14) << "instructions" << setw(10)
+       << "calls" << setw(12) << "peak RSS KB" << endl;
+  for (int i = 0; i < programs.size(); ++i) {
+    BenchResult& r = results[i];
+    try {
+      // one counted run (also a warm-up), then the timed runs
+      VMStats stats;
+      string output = run_program(sources[i], &stats);
+      // a wrong result is an error (and is not timed)
+      string expected_name = expected_files[i].filename().string();
+      if (!filesystem::exists(expected_files[i]))
+        r.error = "missing expected output " + expected_name;
+      else if (output != read_file(expected_files[i]))
+        r.error = "output differs from " + expected_name;
+      r.instructions = stats.instructions;
+      r.calls = stats.calls;
+      counters.reset();
+      for (int j = 0; j < runs and r.error.empty(); ++j) {
+        auto start = chrono::steady_clock::now();
+        run_program(sources[i], nullptr, &counters);
+        auto end = chrono::steady_clock::now();
+        r.times.push_back(chrono::duration<double, milli>(end - start).count());
+      }
+      for (int c = 0; c < PerfCounters::COUNTER_COUNT; ++c) {
+        long total = counters.total(PerfCounters::Counter(c));
+        r.counters[c] = total < 0 ? -1 : (double) total / runs;
+      }
+    } catch (MyPLException& ex) {
+      r.error = ex.what();
+    }
+    if (!r.error.empty()) {
+      cout << left << setw(16) << r.name << r.error << endl;
+      continue;
+    }
+    cout << left << setw(16) << r.name << right << fixed << setprecision(1)
+         << setw(12) << median(r.times) << setw(12)
+         << *min_element(r.times.begin(), r.times.end()) << setw(14)
+         << r.instructions << setw(10) << r.calls << setw(12)
+         << r.peak_rss_kb << endl;
+  }
+
+  if (counters.any_available())
+    print_counters(results);
+
+  ofstream out(results_file);
+  if (!out) {
+    cerr << "cannot write " << results_file << endl;
+    return 1;
+  }
+  write_json(out, results, runs, counters);
+  cout << "results written to " << results_file << endl;
+  bool failed = any_of(results.begin(), results.end(), [](auto& r) {
+    return !r.error.empty();
+  });
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+//----------------------------------------------------------------------
+// FILE: perf_counters.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the hardware performance counters
+//----------------------------------------------------------------------
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+using namespace std;
+
+
+namespace {
+
+  // the event type and config of each counter
+  struct EventConfig
+  {
+    uint32_t type;
+    uint64_t config;
+  };
+
+  constexpr uint64_t cache_read_misses(uint64_t cache)
+  {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+
+  const EventConfig events[PerfCounters::COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_read_misses(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_read_misses(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HW_CACHE, cache_read_misses(PERF_COUNT_HW_CACHE_DTLB)}};
+
+  const char* names[PerfCounters::COUNTER_COUNT] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses",
+    "dtlb_misses"};
+
+  // the value read from a counter
+  struct Reading
+  {
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+  };
+
+}
+
+
+PerfCounters::PerfCounters()
+{
+  for (int i = 0; i < COUNTER_COUNT; ++i) {
+    perf_event_attr attr {};
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // this thread on any cpu
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds[i] < 0 and open_error.empty())
+      open_error = string(names[i]) + ": " + strerror(errno);
+  }
+}
+
+
+PerfCounters::~PerfCounters()
+{
+  for (int fd : fds) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+
+bool PerfCounters::any_available() const
+{
+  for (int fd : fds) {
+    if (fd >= 0)
+      return true;
+  }
+  return false;
+}
+
+
+const char* PerfCounters::name(Counter c)
+{
+  return names[c];
+}
+
+
+void PerfCounters::reset()
+{
+  totals.fill(0);
+  counted.fill(false);
+}
+
+
+void PerfCounters::start()
+{
+  for (int fd : fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+
+void PerfCounters::stop()
+{
+  for (int fd : fds) {
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int i = 0; i < COUNTER_COUNT; ++i) {
+    Reading r {};
+    if (fds[i] < 0 or read(fds[i], &r, sizeof(r)) != sizeof(r) or
+        r.time_running == 0)
+      continue;
+    // scale up for the time the counter was multiplexed out
+    totals[i] += (double) r.value * r.time_enabled / r.time_running;
+    counted[i] = true;
+  }
+}
+
+
+long PerfCounters::total(Counter c) const
+{
+  return counted[c] ? (long) totals[c] : -1;
+}
@@ -0,0 +1,68 @@
+//----------------------------------------------------------------------
+// FILE: perf_counters.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Linux hardware performance counters (via perf_event_open)
+//----------------------------------------------------------------------
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <string>
+
+
+// Counts hardware events of this thread (in user mode) between start
+// and stop calls, summing over all the intervals since the last reset.
+// Each counter is opened on its own, so any the kernel or machine does
+// not support (e.g., in a VM or container, or with a restrictive
+// perf_event_paranoid) are just unavailable. Counts of counters the
+// PMU multiplexed are scaled up to the full interval.
+
+class PerfCounters
+{
+public:
+
+  enum Counter {CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES,
+                DTLB_MISSES, COUNTER_COUNT};
+
+  // open the counters (disabled)
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // true if the counter could be opened
+  bool available(Counter c) const {return fds[c] >= 0;}
+  bool any_available() const;
+
+  // why the first unavailable counter could not be opened (empty if
+  // all are available)
+  const std::string& error() const {return open_error;}
+
+  // a short name of the counter (e.g., "branch_misses")
+  static const char* name(Counter c);
+
+  // zero the totals
+  void reset();
+
+  // count from now until stop
+  void start();
+  void stop();
+
+  // the total count of the intervals since the last reset (-1 if the
+  // counter is unavailable or never ran)
+  long total(Counter c) const;
+
+private:
+
+  std::array<int, COUNTER_COUNT> fds;
+  std::array<double, COUNTER_COUNT> totals {};
+  std::array<bool, COUNTER_COUNT> counted {};
+  std::string open_error;
+
+};
+
+
+#endif
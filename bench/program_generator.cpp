@@ -0,0 +1,249 @@
+//----------------------------------------------------------------------
+// FILE: program_generator.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the synthetic MyPL program generator
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include "program_generator.h"
+
+using namespace std;
+
+
+ProgramGenerator::ProgramGenerator(const Config& config)
+  : config(config), rng(config.seed)
+{
+  this->config.functions = max(1, config.functions);
+  this->config.statements = max(0, config.statements);
+  this->config.max_depth = max(0, config.max_depth);
+  this->config.expression_length = max(1, config.expression_length);
+}
+
+
+string ProgramGenerator::generate()
+{
+  out.clear();
+  rng.seed(config.seed);
+  for (int i = 0; i < config.structs; ++i)
+    struct_def(i);
+  for (int i = 0; i < config.classes; ++i)
+    class_def(i);
+  for (int i = 0; i < config.functions; ++i)
+    fun_def(i);
+  out += "void main() {\n";
+  out += "  print(f" + to_string(config.functions - 1) + "(1, 2))\n";
+  out += "}\n";
+  return out;
+}
+
+
+int ProgramGenerator::random(int n)
+{
+  return uniform_int_distribution<int>(0, n - 1)(rng);
+}
+
+
+string ProgramGenerator::new_var(const string& type)
+{
+  string name = "v" + to_string(var_count++);
+  scopes.back().push_back({name, type});
+  return name;
+}
+
+
+vector<string> ProgramGenerator::vars(const string& type) const
+{
+  vector<string> names;
+  for (auto& scope : scopes) {
+    for (auto& [name, var_type] : scope) {
+      if (var_type == type)
+        names.push_back(name);
+    }
+  }
+  return names;
+}
+
+
+vector<pair<string, string>> ProgramGenerator::object_vars() const
+{
+  vector<pair<string, string>> objects;
+  for (auto& scope : scopes) {
+    for (auto& var : scope) {
+      if (var.second[0] == 'S' or var.second[0] == 'C')
+        objects.push_back(var);
+    }
+  }
+  return objects;
+}
+
+
+void ProgramGenerator::struct_def(int i)
+{
+  string name = "S" + to_string(i);
+  out += "struct " + name + " {int a, double b, string c, " + name +
+    " next}\n\n";
+}
+
+
+void ProgramGenerator::class_def(int i)
+{
+  string name = "C" + to_string(i);
+  out += "class " + name + " {\n";
+  out += "  private:\n";
+  out += "    int hidden\n\n";
+  out += "  public:\n";
+  out += "    int count\n";
+  out += "    double total\n\n";
+  out += "    int bump" + to_string(i) + "(" + name + " o, int x) {\n";
+  out += "      o.count = o.count + x\n";
+  out += "      return o.count\n";
+  out += "    }\n";
+  out += "}\n\n";
+}
+
+
+void ProgramGenerator::fun_def(int i)
+{
+  function = i;
+  var_count = 0;
+  scopes.assign(1, {{"a", "int"}, {"b", "int"}});
+  out += "int f" + to_string(i) + "(int a, int b) {\n";
+  block(1, config.statements);
+  out += "  return " + int_expr(config.expression_length) + "\n";
+  out += "}\n\n";
+}
+
+
+void ProgramGenerator::block(int depth, int statements)
+{
+  while (statements > 0)
+    statements -= statement(depth, statements);
+}
+
+
+int ProgramGenerator::statement(int depth, int budget)
+{
+  string indent(2 * depth, ' ');
+  int length = config.expression_length;
+  int kind = random(10);
+  // compound statements need room for a body
+  bool nested = depth <= config.max_depth and budget > 1;
+  if (kind >= 7 and !nested)
+    kind = random(7);
+
+  if (kind == 1 and !vars("int").empty()) {
+    vector<string> ints = vars("int");
+    out += indent + ints[random(ints.size())] + " = " + int_expr(length) +
+      "\n";
+    return 1;
+  }
+  if (kind == 2 and config.structs > 0) {
+    string type = "S" + to_string(random(config.structs));
+    string expr = int_expr(length);
+    string name = new_var(type);
+    out += indent + type + " " + name + " = new " + type + "\n";
+    out += indent + name + ".a = " + expr + "\n";
+    return 1;
+  }
+  if (kind == 3 and config.classes > 0) {
+    int c = random(config.classes);
+    string type = "C" + to_string(c);
+    string expr = int_expr(length);
+    string name = new_var(type);
+    out += indent + type + " " + name + " = new " + type + "\n";
+    out += indent + name + ".count = 0\n";
+    string result = new_var("int");
+    out += indent + "int " + result + " = " + name + ".bump" + to_string(c) +
+      "(" + name + ", " + expr + ")\n";
+    return 1;
+  }
+  if (kind == 4 and function > 0) {
+    string callee = "f" + to_string(random(function));
+    string expr = callee + "(" + int_expr(1) + ", " + int_expr(1) + ")";
+    out += indent + "int " + new_var("int") + " = " + expr + "\n";
+    return 1;
+  }
+  if (kind == 5) {
+    string expr = int_expr(length);
+    out += indent + "double " + new_var("double") + " = 1.5 * 2.0 + 0.25\n";
+    out += indent + "string " + new_var("string") + " = concat(\"v\", " +
+      "to_string(" + expr + "))\n";
+    return 1;
+  }
+  if (kind >= 7) {
+    // the body gets a share of the remaining statements
+    int body = 1 + random(min(budget - 1, max(1, config.statements / 4)));
+    scopes.push_back({});
+    if (kind == 7) {
+      out += indent + "if (" + condition() + ") {\n";
+      block(depth + 1, (body + 1) / 2);
+      scopes.back().clear();
+      out += indent + "} elseif (" + condition() + ") {\n";
+      out += indent + "  int " + new_var("int") + " = 0\n";
+      scopes.back().clear();
+      out += indent + "} else {\n";
+      block(depth + 1, body / 2);
+      out += indent + "}\n";
+    }
+    else if (kind == 8) {
+      out += indent + "while (" + condition() + ") {\n";
+      block(depth + 1, body);
+      out += indent + "}\n";
+    }
+    else {
+      string i = "i" + to_string(var_count++);
+      scopes.back().push_back({i, "int"});
+      out += indent + "for (int " + i + " = 0; " + i + " < (" +
+        int_expr(length) + "); " + i + " = " + i + " + 1) {\n";
+      block(depth + 1, body);
+      out += indent + "}\n";
+    }
+    scopes.pop_back();
+    return 1 + body;
+  }
+  // an int declaration (the default)
+  string expr = int_expr(length);
+  out += indent + "int " + new_var("int") + " = " + expr + "\n";
+  return 1;
+}
+
+
+string ProgramGenerator::int_expr(int length)
+{
+  static const char* ops[] = {" + ", " - ", " * "};
+  string expr = int_term();
+  for (int i = 1; i < length; ++i)
+    expr += ops[random(3)] + int_term();
+  return expr;
+}
+
+
+string ProgramGenerator::int_term()
+{
+  int kind = random(6);
+  if (kind == 0 or kind == 1)
+    return to_string(random(100));
+  if (kind == 2) {
+    // a struct field or class member
+    vector<pair<string, string>> objects = object_vars();
+    if (!objects.empty()) {
+      auto& [name, type] = objects[random(objects.size())];
+      return name + (type[0] == 'S' ? ".a" : ".count");
+    }
+  }
+  if (kind == 3)
+    return "(" + to_string(random(10)) + " + " + to_string(random(10)) + ")";
+  vector<string> ints = vars("int");
+  return ints[random(ints.size())];
+}
+
+
+string ProgramGenerator::condition()
+{
+  int length = max(1, config.expression_length / 2);
+  string cond = "(" + int_expr(length) + ") < (" + int_expr(length) + ")";
+  if (random(2))
+    cond = "(" + cond + ") and (not (" + int_term() + " == 0))";
+  return cond;
+}
@@ -0,0 +1,80 @@
+//----------------------------------------------------------------------
+// FILE: program_generator.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Generator of valid synthetic MyPL programs of a given size
+//----------------------------------------------------------------------
+
+#ifndef PROGRAM_GENERATOR_H
+#define PROGRAM_GENERATOR_H
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Generates random (but repeatable for a seed) MyPL programs that pass
+// the semantic checker: structs and classes, int functions whose
+// bodies mix declarations, assignments, struct and class use, calls to
+// earlier functions, and nested if, while, and for statements, plus a
+// main calling the last function. Generated programs are not meant to
+// be run (loops need not terminate).
+
+class ProgramGenerator
+{
+public:
+
+  class Config
+  {
+  public:
+    int functions = 10;
+    int structs = 2;
+    int classes = 2;
+    // statements per function body (counting nested ones)
+    int statements = 20;
+    // deepest nesting of if, while, and for statements
+    int max_depth = 3;
+    // terms per arithmetic expression
+    int expression_length = 4;
+    unsigned seed = 1;
+  };
+
+  ProgramGenerator(const Config& config);
+
+  // the program's source code
+  std::string generate();
+
+private:
+
+  Config config;
+  std::mt19937 rng;
+  std::string out;
+
+  // the variables in scope (innermost last) as (name, type) pairs, and
+  // the count used to make names unique within a function
+  std::vector<std::vector<std::pair<std::string, std::string>>> scopes;
+  int var_count = 0;
+
+  // the function being generated
+  int function = 0;
+
+  int random(int n);
+  std::string new_var(const std::string& type);
+  std::vector<std::string> vars(const std::string& type) const;
+  std::vector<std::pair<std::string, std::string>> object_vars() const;
+
+  void struct_def(int i);
+  void class_def(int i);
+  void fun_def(int i);
+  void block(int depth, int statements);
+  int statement(int depth, int budget);
+
+  std::string int_expr(int length);
+  std::string int_term();
+  std::string condition();
+
+};
+
+
+#endif
@@ -0,0 +1,304 @@
+//----------------------------------------------------------------------
+// FILE: vm_opcode_bench.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Google Benchmark cost of each VM opcode family, run as a loop
+// over a short stack-neutral instruction sequence built directly as
+// VMFrameInfo code (as in the VM unit tests). Reports the time per
+// executed instruction (sequence, helper, and loop instructions all
+// counted).
+// USAGE: vm_opcode_bench [benchmark flags]
+//----------------------------------------------------------------------
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "vm.h"
+#include "vm_verifier.h"
+#include "run_stats.h"
+
+using namespace std;
+
+
+// loop iterations per run and copies of the sequence per iteration
+const int LOOPS = 200;
+const int UNROLL = 16;
+
+
+// A sequence to measure: its setup (run once before the loop, using
+// variable slots from 1 on), its instructions (given the pc of its
+// first one, for jumps), and any functions it calls.
+
+class OpcodeCase
+{
+public:
+  string family;
+  string name;
+  vector<VMInstr> setup;
+  function<vector<VMInstr>(int)> body;
+  vector<VMFrameInfo> functions;
+};
+
+
+// the main frame looping over the case's sequence
+VMFrameInfo loop_frame(const OpcodeCase& c)
+{
+  VMFrameInfo main {"main", 0};
+  vector<VMInstr>& code = main.instructions;
+  code = c.setup;
+  code.push_back(VMInstr::PUSH(0));
+  code.push_back(VMInstr::STORE(0));
+  int start = code.size();
+  code.push_back(VMInstr::LOAD(0));
+  code.push_back(VMInstr::PUSH(LOOPS));
+  code.push_back(VMInstr::CMPLT_INT());
+  int exit_jump = code.size();
+  code.push_back(VMInstr::JMPF(0));
+  for (int i = 0; i < UNROLL; ++i) {
+    vector<VMInstr> body = c.body(code.size());
+    code.insert(code.end(), body.begin(), body.end());
+  }
+  code.push_back(VMInstr::LOAD(0));
+  code.push_back(VMInstr::PUSH(1));
+  code.push_back(VMInstr::ADD_INT());
+  code.push_back(VMInstr::STORE(0));
+  code.push_back(VMInstr::JMP(start));
+  // one past the end finishes the run
+  code[exit_jump] = VMInstr::JMPF(code.size());
+  return main;
+}
+
+
+void run_case(benchmark::State& state, const OpcodeCase& c)
+{
+  // verify the frames once (so runs in new VMs skip it)
+  vector<VMFrameInfo> frames = c.functions;
+  frames.push_back(loop_frame(c));
+  auto arg_count = [&frames](const string& name) {
+    for (auto& f : frames) {
+      if (f.function_name == name)
+        return f.arg_count;
+    }
+    return -1;
+  };
+  VMVerifier verifier;
+  for (auto& f : frames)
+    verifier.verify(f, arg_count);
+
+  // the instructions each run executes
+  VMStats stats;
+  {
+    VM vm;
+    for (auto& f : frames)
+      vm.add(f);
+    vm.add_profiler(stats);
+    vm.run();
+  }
+
+  // each run in a new VM (heap objects are never freed)
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      VM vm;
+      for (auto& f : frames)
+        vm.add(f);
+      state.ResumeTiming();
+      vm.run();
+      state.PauseTiming();
+    }
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * stats.instructions);
+  state.counters["instrs"] = stats.instructions;
+  // the inverted rate of instructions is the time per instruction
+  state.counters["time/instr"] = benchmark::Counter(
+    stats.instructions, benchmark::Counter::kIsIterationInvariantRate |
+    benchmark::Counter::kInvert);
+}
+
+
+// a case whose sequence does not depend on its pc
+OpcodeCase simple(const string& family, const string& name,
+                  vector<VMInstr> body, vector<VMInstr> setup = {})
+{
+  return {family, name, setup, [body](int) {return body;}, {}};
+}
+
+
+vector<OpcodeCase> cases()
+{
+  vector<OpcodeCase> all;
+  using I = VMInstr;
+
+  // stack
+  all.push_back(simple("stack", "NOP", {I::NOP()}));
+  all.push_back(simple("stack", "PUSH_POP", {I::PUSH(1), I::POP()}));
+  all.push_back(simple("stack", "LOAD_STORE", {I::LOAD(1), I::STORE(1)},
+                       {I::PUSH(1), I::STORE(1)}));
+  all.push_back(simple("stack", "DUP",
+                       {I::PUSH(1), I::DUP(), I::POP(), I::POP()}));
+
+  // arithmetic (generic ops on each type and the typed ops)
+  vector<pair<string, VMInstr>> arith {
+    {"ADD", I::ADD()}, {"SUB", I::SUB()}, {"MUL", I::MUL()},
+    {"DIV", I::DIV()}};
+  for (auto& [name, op] : arith) {
+    all.push_back(simple("arith", name + "/int",
+                         {I::PUSH(7), I::PUSH(3), op, I::POP()}));
+    all.push_back(simple("arith", name + "/double",
+                         {I::PUSH(7.5), I::PUSH(2.5), op, I::POP()}));
+  }
+  all.push_back(simple("arith", "ADD_INT",
+                       {I::PUSH(7), I::PUSH(3), I::ADD_INT(), I::POP()}));
+  all.push_back(simple("arith", "SUB_INT",
+                       {I::PUSH(7), I::PUSH(3), I::SUB_INT(), I::POP()}));
+  all.push_back(simple("arith", "MUL_INT",
+                       {I::PUSH(7), I::PUSH(3), I::MUL_INT(), I::POP()}));
+  all.push_back(simple("arith", "DIV_INT",
+                       {I::PUSH(7), I::PUSH(3), I::DIV_INT(), I::POP()}));
+  all.push_back(simple("arith", "ADD_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::ADD_DBL(), I::POP()}));
+  all.push_back(simple("arith", "SUB_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::SUB_DBL(), I::POP()}));
+  all.push_back(simple("arith", "MUL_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::MUL_DBL(), I::POP()}));
+  all.push_back(simple("arith", "DIV_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::DIV_DBL(), I::POP()}));
+
+  // logic
+  all.push_back(simple("logic", "AND",
+                       {I::PUSH(true), I::PUSH(false), I::AND(), I::POP()}));
+  all.push_back(simple("logic", "OR",
+                       {I::PUSH(true), I::PUSH(false), I::OR(), I::POP()}));
+  all.push_back(simple("logic", "NOT", {I::PUSH(true), I::NOT(), I::POP()}));
+
+  // compares (generic ops on ints, doubles, and strings, and typed ops)
+  vector<pair<string, VMInstr>> compares {
+    {"CMPLT", I::CMPLT()}, {"CMPLE", I::CMPLE()}, {"CMPGT", I::CMPGT()},
+    {"CMPGE", I::CMPGE()}, {"CMPEQ", I::CMPEQ()}, {"CMPNE", I::CMPNE()}};
+  for (auto& [name, op] : compares) {
+    all.push_back(simple("compare", name + "/int",
+                         {I::PUSH(7), I::PUSH(3), op, I::POP()}));
+    all.push_back(simple("compare", name + "/double",
+                         {I::PUSH(7.5), I::PUSH(2.5), op, I::POP()}));
+  }
+  all.push_back(simple("compare", "CMPEQ/string",
+                       {I::PUSH(string("abc")), I::PUSH(string("abd")),
+                        I::CMPEQ(), I::POP()}));
+  all.push_back(simple("compare", "CMPEQ/null",
+                       {I::PUSH(nullptr), I::PUSH(3), I::CMPEQ(), I::POP()}));
+  all.push_back(simple("compare", "CMPLT_INT",
+                       {I::PUSH(7), I::PUSH(3), I::CMPLT_INT(), I::POP()}));
+  all.push_back(simple("compare", "CMPGE_INT",
+                       {I::PUSH(7), I::PUSH(3), I::CMPGE_INT(), I::POP()}));
+  all.push_back(simple("compare", "CMPLT_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::CMPLT_DBL(), I::POP()}));
+  all.push_back(simple("compare", "CMPGE_DBL",
+                       {I::PUSH(7.5), I::PUSH(2.5), I::CMPGE_DBL(), I::POP()}));
+
+  // jumps (each to just past itself)
+  all.push_back({"jump", "JMP", {}, [](int pc) {
+    return vector<VMInstr> {I::JMP(pc + 1)};
+  }, {}});
+  all.push_back({"jump", "JMPF/taken", {}, [](int pc) {
+    return vector<VMInstr> {I::PUSH(false), I::JMPF(pc + 2)};
+  }, {}});
+  all.push_back({"jump", "JMPF/not_taken", {}, [](int pc) {
+    return vector<VMInstr> {I::PUSH(true), I::JMPF(pc + 2)};
+  }, {}});
+
+  // calls
+  VMFrameInfo f0 {"f0", 0};
+  f0.instructions = {I::PUSH(nullptr), I::RET()};
+  all.push_back({"call", "CALL_RET/0", {}, [](int) {
+    return vector<VMInstr> {I::CALL("f0"), I::POP()};
+  }, {f0}});
+  VMFrameInfo f2 {"f2", 2};
+  f2.instructions = {I::STORE(0), I::STORE(1), I::LOAD(0), I::RET()};
+  all.push_back({"call", "CALL_RET/2", {}, [](int) {
+    return vector<VMInstr> {I::PUSH(1), I::PUSH(2), I::CALL("f2"), I::POP()};
+  }, {f2}});
+
+  // heap (with a struct of fields a, b, and c, an array of 16 ints, or
+  // a class with member m in slot 1)
+  vector<VMInstr> new_struct {
+    I::ALLOCS(), I::DUP(), I::ADDF("a"), I::DUP(), I::ADDF("b"), I::DUP(),
+    I::ADDF("c"), I::STORE(1)};
+  vector<VMInstr> new_array {I::PUSH(16), I::PUSH(0), I::ALLOCA(), I::STORE(1)};
+  vector<VMInstr> new_object {
+    I::ALLOCC(), I::DUP(), I::ADDMEM("m"), I::STORE(1)};
+  all.push_back(simple("heap", "ALLOCS", {I::ALLOCS(), I::POP()}));
+  all.push_back(simple("heap", "ALLOCS_ADDF", {I::ALLOCS(), I::ADDF("a")}));
+  all.push_back(simple("heap", "SETF",
+                       {I::LOAD(1), I::PUSH(5), I::SETF("c")}, new_struct));
+  all.push_back(simple("heap", "GETF",
+                       {I::LOAD(1), I::GETF("c"), I::POP()}, new_struct));
+  all.push_back(simple("heap", "SETF_SLOT",
+                       {I::LOAD(1), I::PUSH(5), I::SETF_SLOT(2)}, new_struct));
+  all.push_back(simple("heap", "GETF_SLOT",
+                       {I::LOAD(1), I::GETF_SLOT(2), I::POP()}, new_struct));
+  all.push_back(simple("heap", "ALLOCA",
+                       {I::PUSH(16), I::PUSH(0), I::ALLOCA(), I::POP()}));
+  all.push_back(simple("heap", "SETI",
+                       {I::LOAD(1), I::PUSH(3), I::PUSH(7), I::SETI()},
+                       new_array));
+  all.push_back(simple("heap", "GETI",
+                       {I::LOAD(1), I::PUSH(3), I::GETI(), I::POP()},
+                       new_array));
+  all.push_back(simple("heap", "ALEN",
+                       {I::LOAD(1), I::ALEN(), I::POP()}, new_array));
+  all.push_back(simple("heap", "ALLOCC", {I::ALLOCC(), I::POP()}));
+  all.push_back(simple("heap", "ALLOCC_ADDMEM",
+                       {I::ALLOCC(), I::ADDMEM("m")}));
+  all.push_back(simple("heap", "ALLOCC_ADDMTH",
+                       {I::ALLOCC(), I::ADDMTH("f")}));
+  all.push_back(simple("heap", "SETMEM",
+                       {I::LOAD(1), I::PUSH(5), I::SETMEM("m")}, new_object));
+  all.push_back(simple("heap", "GETMEM",
+                       {I::LOAD(1), I::GETMEM("m"), I::POP()}, new_object));
+  all.push_back(simple("heap", "SETMTH",
+                       {I::LOAD(1), I::PUSH(string("f")), I::SETMTH("f")},
+                       new_object));
+
+  // string built-ins and conversions
+  all.push_back(simple("string", "SLEN",
+                       {I::PUSH(string("hello world")), I::SLEN(), I::POP()}));
+  all.push_back(simple("string", "GETC",
+                       {I::PUSH(4), I::PUSH(string("hello world")), I::GETC(),
+                        I::POP()}));
+  all.push_back(simple("string", "CONCAT",
+                       {I::PUSH(string("hello ")), I::PUSH(string("world")),
+                        I::CONCAT(), I::POP()}));
+  all.push_back(simple("string", "TOSTR/int",
+                       {I::PUSH(42), I::TOSTR(), I::POP()}));
+  all.push_back(simple("string", "TOSTR/double",
+                       {I::PUSH(4.25), I::TOSTR(), I::POP()}));
+  all.push_back(simple("string", "TOINT/string",
+                       {I::PUSH(string("42")), I::TOINT(), I::POP()}));
+  all.push_back(simple("string", "TOINT/double",
+                       {I::PUSH(4.75), I::TOINT(), I::POP()}));
+  all.push_back(simple("string", "TODBL/string",
+                       {I::PUSH(string("4.25")), I::TODBL(), I::POP()}));
+  all.push_back(simple("string", "TODBL/int",
+                       {I::PUSH(42), I::TODBL(), I::POP()}));
+
+  return all;
+}
+
+
+int main(int argc, char* argv[])
+{
+  static vector<OpcodeCase> all = cases();
+  for (const OpcodeCase& c : all) {
+    benchmark::RegisterBenchmark((c.family + "/" + c.name).c_str(),
+                                 [&c](benchmark::State& state) {
+                                   run_case(state, c);
+                                 })->Unit(benchmark::kMicrosecond);
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
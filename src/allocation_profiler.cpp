@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------
+// FILE: allocation_profiler.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the allocation site profiler
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <iomanip>
+#include <unordered_set>
+#include "allocation_profiler.h"
+
+using namespace std;
+
+
+void AllocationProfiler::start(const VMFrame& main)
+{
+  site_list.clear();
+  site_ids.clear();
+  object_sites.clear();
+  pending_site = -1;
+  depth = 1;
+  roots.clear();
+}
+
+
+void AllocationProfiler::instruction(const VMFrame& frame,
+                                     const VMInstr& instr)
+{
+  // an alloc is never the last instruction of a frame
+  if (pending_site >= 0) {
+    const VMValue& oid = frame.operand_stack.top();
+    if (holds_alternative<int>(oid))
+      object_sites[get<int>(oid)] = pending_site;
+    pending_site = -1;
+  }
+  OpCode op = instr.opcode();
+  if (op != OpCode::ALLOCS and op != OpCode::ALLOCA and op != OpCode::ALLOCC)
+    return;
+  int next_id = site_list.size();
+  auto [entry, is_new] = site_ids.insert({{frame.info.function_name,
+                                           frame.pc}, next_id});
+  if (is_new) {
+    Site site;
+    site.function = frame.info.function_name;
+    site.pc = frame.pc;
+    site.opcode = op;
+    const VMLineEntry* pos = source_position(frame.info, frame.pc);
+    if (pos)
+      site.line = pos->line;
+    site_list.push_back(site);
+  }
+  ++site_list[entry->second].count;
+  pending_site = entry->second;
+}
+
+
+void AllocationProfiler::call(const VMFrame& caller, const VMFrame& callee)
+{
+  ++depth;
+}
+
+
+void AllocationProfiler::ret(const VMFrame& frame)
+{
+  if (--depth > 0)
+    return;
+  // main returns with its value on top of the operand stack
+  for (const VMValue& v : frame.variables) {
+    if (holds_alternative<int>(v))
+      roots.push_back(get<int>(v));
+  }
+  if (!frame.operand_stack.empty() and
+      holds_alternative<int>(frame.operand_stack.top()))
+    roots.push_back(get<int>(frame.operand_stack.top()));
+}
+
+
+vector<AllocationProfiler::Site> AllocationProfiler::sites(const VM& vm) const
+{
+  // the objects reachable from main at exit
+  unordered_set<int> live;
+  vector<int> pending;
+  for (int oid : roots) {
+    if (!vm.object_heap(oid).empty() and live.insert(oid).second)
+      pending.push_back(oid);
+  }
+  while (!pending.empty()) {
+    int oid = pending.back();
+    pending.pop_back();
+    for (int to : vm.object_refs(oid)) {
+      if (live.insert(to).second)
+        pending.push_back(to);
+    }
+  }
+
+  vector<Site> result = site_list;
+  for (auto [oid, id] : object_sites) {
+    long bytes = vm.object_bytes(oid);
+    result[id].bytes += bytes;
+    if (live.contains(oid)) {
+      ++result[id].live;
+      result[id].live_bytes += bytes;
+    }
+  }
+  stable_sort(result.begin(), result.end(), [](auto& x, auto& y) {
+    return x.bytes > y.bytes;
+  });
+  return result;
+}
+
+
+void AllocationProfiler::print(ostream& out, const VM& vm, int top) const
+{
+  vector<Site> sorted = sites(vm);
+  long count = 0;
+  long bytes = 0;
+  long live = 0;
+  long live_bytes = 0;
+  for (auto& site : sorted) {
+    count += site.count;
+    bytes += site.bytes;
+    live += site.live;
+    live_bytes += site.live_bytes;
+  }
+
+  out << left << setw(24) << "site" << setw(8) << "op" << right << setw(6)
+      << "line" << setw(10) << "allocs" << setw(12) << "bytes" << setw(10)
+      << "live" << setw(12) << "live bytes" << endl;
+  int n = top > 0 ? min(top, (int) sorted.size()) : sorted.size();
+  for (int i = 0; i < n; ++i) {
+    const Site& site = sorted[i];
+    out << left << setw(24) << site.function + "@" + to_string(site.pc)
+        << setw(8) << to_string(site.opcode) << right << setw(6)
+        << site.line << setw(10) << site.count << setw(12) << site.bytes
+        << setw(10) << site.live << setw(12) << site.live_bytes << endl;
+  }
+  out << left << setw(38) << "total" << right << setw(10) << count
+      << setw(12) << bytes << setw(10) << live << setw(12) << live_bytes
+      << endl;
+}
@@ -0,0 +1,77 @@
+//----------------------------------------------------------------------
+// FILE: allocation_profiler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Allocation counts and sizes of each heap allocation site
+//----------------------------------------------------------------------
+
+#ifndef ALLOCATION_PROFILER_H
+#define ALLOCATION_PROFILER_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm_profiler.h"
+#include "vm.h"
+
+
+// Records the site (function and pc) of every ALLOCS, ALLOCA, and
+// ALLOCC of a VM run. After the run, each site's objects are sized
+// and checked for being live at exit, i.e., reachable from main's
+// variables or return value when main returned (the heaps never free
+// objects, so this is what a collector would keep).
+
+class AllocationProfiler : public VMProfiler
+{
+public:
+
+  class Site
+  {
+  public:
+    std::string function;
+    int pc = 0;
+    OpCode opcode = OpCode::NOP;
+    // source line of the allocation (0 if not known)
+    int line = 0;
+    long count = 0;
+    // approximate size of the site's objects at exit
+    long bytes = 0;
+    long live = 0;
+    long live_bytes = 0;
+  };
+
+  void start(const VMFrame& main) override;
+  void instruction(const VMFrame& frame, const VMInstr& instr) override;
+  void call(const VMFrame& caller, const VMFrame& callee) override;
+  void ret(const VMFrame& frame) override;
+
+  // the sites by decreasing bytes, given the VM that ran
+  std::vector<Site> sites(const VM& vm) const;
+
+  // print the top sites (all if top is 0)
+  void print(std::ostream& out, const VM& vm, int top = 20) const;
+
+private:
+
+  // the sites (in order of first allocation) and their indexes
+  std::vector<Site> site_list;
+  std::map<std::pair<std::string, int>, int> site_ids;
+
+  // the site of each object
+  std::unordered_map<int, int> object_sites;
+
+  // the site of the last instruction if it allocated (its oid is on
+  // top of the operand stack before the next instruction)
+  int pending_site = -1;
+
+  // frames on the call stack and the objects main referred to at exit
+  int depth = 0;
+  std::vector<int> roots;
+
+};
+
+
+#endif
@@ -0,0 +1,248 @@
+//----------------------------------------------------------------------
+// FILE: ast.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the AST node arena and definition index
+//----------------------------------------------------------------------
+
+#include "ast.h"
+
+using namespace std;
+
+
+// helper to append a node to a pool and return its index
+template<typename T>
+static NodeIndex push_node(vector<T>& pool, T&& node)
+{
+  pool.push_back(std::move(node));
+  return (NodeIndex) (pool.size() - 1);
+}
+
+
+StmtRef ASTArena::add(ReturnStmt&& s)
+{
+  return StmtRef {StmtKind::RETURN, push_node(return_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add(WhileStmt&& s)
+{
+  return StmtRef {StmtKind::WHILE, push_node(while_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add(ForStmt&& s)
+{
+  return StmtRef {StmtKind::FOR, push_node(for_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add(IfStmt&& s)
+{
+  return StmtRef {StmtKind::IF, push_node(if_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add(VarDeclStmt&& s)
+{
+  return StmtRef {StmtKind::VAR_DECL, push_node(var_decl_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add(AssignStmt&& s)
+{
+  return StmtRef {StmtKind::ASSIGN, push_node(assign_stmts, std::move(s))};
+}
+
+StmtRef ASTArena::add_stmt(CallExpr&& e)
+{
+  return StmtRef {StmtKind::CALL, push_node(call_exprs, std::move(e))};
+}
+
+TermRef ASTArena::add(SimpleTerm&& t)
+{
+  return TermRef {TermKind::SIMPLE, push_node(simple_terms, std::move(t))};
+}
+
+TermRef ASTArena::add(ComplexTerm&& t)
+{
+  return TermRef {TermKind::COMPLEX, push_node(complex_terms, std::move(t))};
+}
+
+RValueRef ASTArena::add(SimpleRValue&& v)
+{
+  return RValueRef {RValueKind::SIMPLE, push_node(simple_rvalues, std::move(v))};
+}
+
+RValueRef ASTArena::add(NewRValue&& v)
+{
+  return RValueRef {RValueKind::NEW, push_node(new_rvalues, std::move(v))};
+}
+
+RValueRef ASTArena::add(VarRValue&& v)
+{
+  return RValueRef {RValueKind::VAR, push_node(var_rvalues, std::move(v))};
+}
+
+RValueRef ASTArena::add_rvalue(CallExpr&& e)
+{
+  return RValueRef {RValueKind::CALL, push_node(call_exprs, std::move(e))};
+}
+
+Expr ASTArena::add(const vector<ExprPart>& parts)
+{
+  Expr e {(NodeIndex) expr_parts.size(), (NodeIndex) parts.size()};
+  expr_parts.insert(expr_parts.end(), parts.begin(), parts.end());
+  return e;
+}
+
+span<ExprPart> ASTArena::parts(const Expr& e)
+{
+  if (e.count == 0)
+    return {};
+  return span<ExprPart>(&expr_parts[e.first], e.count);
+}
+
+
+void ASTArena::accept(const StmtRef& ref, Visitor& v)
+{
+  switch (ref.kind) {
+  case StmtKind::RETURN: return_stmts[ref.index].accept(v); break;
+  case StmtKind::WHILE: while_stmts[ref.index].accept(v); break;
+  case StmtKind::FOR: for_stmts[ref.index].accept(v); break;
+  case StmtKind::IF: if_stmts[ref.index].accept(v); break;
+  case StmtKind::VAR_DECL: var_decl_stmts[ref.index].accept(v); break;
+  case StmtKind::ASSIGN: assign_stmts[ref.index].accept(v); break;
+  case StmtKind::CALL: call_exprs[ref.index].accept(v); break;
+  }
+}
+
+void ASTArena::accept(const TermRef& ref, Visitor& v)
+{
+  if (ref.kind == TermKind::SIMPLE)
+    simple_terms[ref.index].accept(v);
+  else
+    complex_terms[ref.index].accept(v);
+}
+
+void ASTArena::accept(const RValueRef& ref, Visitor& v)
+{
+  switch (ref.kind) {
+  case RValueKind::SIMPLE: simple_rvalues[ref.index].accept(v); break;
+  case RValueKind::NEW: new_rvalues[ref.index].accept(v); break;
+  case RValueKind::VAR: var_rvalues[ref.index].accept(v); break;
+  case RValueKind::CALL: call_exprs[ref.index].accept(v); break;
+  }
+}
+
+
+Token ASTArena::first_token(const Expr& e)
+{
+  return first_token(expr_parts[e.first].term);
+}
+
+Token ASTArena::first_token(const TermRef& ref)
+{
+  if (ref.kind == TermKind::SIMPLE)
+    return first_token(simple_terms[ref.index].rvalue);
+  return first_token(complex_terms[ref.index].expr);
+}
+
+Token ASTArena::first_token(const RValueRef& ref)
+{
+  switch (ref.kind) {
+  case RValueKind::SIMPLE: return simple_rvalues[ref.index].first_token();
+  case RValueKind::NEW: return new_rvalues[ref.index].first_token();
+  case RValueKind::VAR: return var_rvalues[ref.index].first_token();
+  default: return call_exprs[ref.index].first_token();
+  }
+}
+
+
+void ASTArena::clear()
+{
+  *this = ASTArena();
+}
+
+
+void DefIndex::build(Program& p)
+{
+  structs.clear();
+  functions.clear();
+  classes.clear();
+  for (const StructDef& s : p.struct_defs) {
+    string name = s.struct_name.lexeme();
+    if (structs.contains(name))
+      continue;
+    StructEntry& entry = structs[name];
+    entry.def = &s;
+    for (const VarDef& f : s.fields)
+      entry.fields.insert({f.var_name.lexeme(), &f});
+  }
+  for (FunDef& f : p.fun_defs)
+    functions[f.fun_name.lexeme()] = &f;
+  for (const ClassDef& c : p.class_defs) {
+    string name = c.class_name.lexeme();
+    if (classes.contains(name))
+      continue;
+    ClassEntry& entry = classes[name];
+    entry.def = &c;
+    for (const VarDef& m : c.public_members)
+      entry.public_members.insert({m.var_name.lexeme(), &m});
+    for (const VarDef& m : c.private_members)
+      entry.private_members.insert({m.var_name.lexeme(), &m});
+    for (const FunDef& m : c.public_methods)
+      entry.public_methods.insert({m.fun_name.lexeme(), &m});
+    for (const FunDef& m : c.private_methods)
+      entry.private_methods.insert({m.fun_name.lexeme(), &m});
+  }
+}
+
+
+const StructDef* DefIndex::get_struct(const string& name) const
+{
+  auto it = structs.find(name);
+  return it == structs.end() ? nullptr : it->second.def;
+}
+
+const FunDef* DefIndex::get_function(const string& name) const
+{
+  auto it = functions.find(name);
+  return it == functions.end() ? nullptr : it->second;
+}
+
+FunDef* DefIndex::get_function(const string& name)
+{
+  auto it = functions.find(name);
+  return it == functions.end() ? nullptr : it->second;
+}
+
+const ClassDef* DefIndex::get_class(const string& name) const
+{
+  auto it = classes.find(name);
+  return it == classes.end() ? nullptr : it->second.def;
+}
+
+
+const VarDef* DefIndex::get_field(const StructDef& struct_def,
+                                  const string& field_name) const
+{
+  const StructEntry& entry = structs.at(struct_def.struct_name.lexeme());
+  auto it = entry.fields.find(field_name);
+  return it == entry.fields.end() ? nullptr : it->second;
+}
+
+const VarDef* DefIndex::get_member(const ClassDef& class_def,
+                                   const string& member_name,
+                                   bool is_public) const
+{
+  const ClassEntry& entry = classes.at(class_def.class_name.lexeme());
+  const auto& members = is_public ? entry.public_members : entry.private_members;
+  auto it = members.find(member_name);
+  return it == members.end() ? nullptr : it->second;
+}
+
+const FunDef* DefIndex::get_method(const ClassDef& class_def,
+                                   const string& method_name,
+                                   bool is_public) const
+{
+  const ClassEntry& entry = classes.at(class_def.class_name.lexeme());
+  const auto& methods = is_public ? entry.public_methods : entry.private_methods;
+  auto it = methods.find(method_name);
+  return it == methods.end() ? nullptr : it->second;
+}
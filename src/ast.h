@@ -7,15 +7,17 @@
 
 
 // NOTE: Guiding principle is to use heap as little as possible and
-// only use pointers when necessary
+// only use pointers when necessary (nodes that would otherwise need
+// one live in the program's ASTArena)
 
 
 #ifndef AST_H
 #define AST_H
 
+#include <cstdint>
 #include <vector>
-#include <memory>
 #include <optional>
+#include <span>
 #include "token.h"
 #include <unordered_map>
 
@@ -78,22 +80,53 @@ public:
   virtual void accept(Visitor& v) = 0;
 };
 
-class Stmt : public ASTNode
+
+//----------------------------------------------------------------------
+// Arena node handles
+//----------------------------------------------------------------------
+
+// Statements, expression terms, rvalues, and nested expressions are
+// stored in per-kind pools of an ASTArena (owned by the Program) and
+// referred to by 32-bit indices instead of shared pointers. The whole
+// tree is released at once when the Program goes away.
+
+typedef std::uint32_t NodeIndex;
+
+// index used for "no node"
+const NodeIndex NULL_NODE = UINT32_MAX;
+
+enum class StmtKind : std::uint8_t {
+  RETURN, WHILE, FOR, IF, VAR_DECL, ASSIGN, CALL
+};
+
+enum class TermKind : std::uint8_t {
+  SIMPLE, COMPLEX
+};
+
+enum class RValueKind : std::uint8_t {
+  SIMPLE, NEW, VAR, CALL
+};
+
+class StmtRef
 {
+public:
+  StmtKind kind = StmtKind::RETURN;
+  NodeIndex index = NULL_NODE;
 };
 
-class ExprTerm : public ASTNode
+class TermRef
 {
 public:
-  // helper to return first token in the term
-  virtual Token first_token() = 0;
+  TermKind kind = TermKind::SIMPLE;
+  NodeIndex index = NULL_NODE;
+  bool is_null() const {return index == NULL_NODE;}
 };
 
-class RValue : public ASTNode
+class RValueRef
 {
 public:
-  // helper to return first token in the rvalue
-  virtual Token first_token() = 0;
+  RValueKind kind = RValueKind::SIMPLE;
+  NodeIndex index = NULL_NODE;
 };
 
 
@@ -102,16 +135,6 @@ public:
 //----------------------------------------------------------------------
 
 
-class Program : public ASTNode
-{
-public:
-  std::vector<StructDef> struct_defs;
-  std::vector<FunDef> fun_defs;
-  std::vector<ClassDef> class_defs;
-  void accept(Visitor& v) { v.visit(*this); }
-};
-
-
 class DataType
 {
 public:
@@ -120,6 +143,13 @@ public:
 };
 
 
+// how a variable path element is accessed, as resolved by the semantic
+// checker (UNKNOWN in trees that were not checked)
+enum class AccessKind : std::uint8_t {
+  UNKNOWN, VAR, FIELD, MEMBER, METHOD
+};
+
+
 class VarDef
 {
 public:
@@ -143,7 +173,12 @@ public:
   DataType return_type;
   Token fun_name;
   std::vector<VarDef> params;
-  std::vector<std::shared_ptr<Stmt>> stmts;
+  std::vector<StmtRef> stmts;
+  // token span [body_begin, body_end) in ASTArena::body_tokens of a
+  // body that was pre-parsed but not yet parsed (see ASTParser)
+  NodeIndex body_begin = NULL_NODE;
+  NodeIndex body_end = NULL_NODE;
+  bool lazy_body() const {return body_begin != NULL_NODE;}
   void accept(Visitor& v) { v.visit(*this); }  
 };
 
@@ -164,37 +199,52 @@ public:
 // Expression-related types
 //----------------------------------------------------------------------
 
+// NOTE: arena nodes are plain classes (no vtable); dispatch from a
+// handle goes through ASTArena::accept
+
 
-class Expr : public ASTNode
+// one term of an expression with the operator following it (none for
+// the last term), where negated means a "not" before the term, which
+// negates the rest of the expression starting at the term
+class ExprPart
 {
 public:
   bool negated = false;
-  std::shared_ptr<ExprTerm> first = nullptr;
+  TermRef term;
   std::optional<Token> op = std::nullopt;
-  std::shared_ptr<Expr> rest = nullptr;
+  DataType type;                       // term's type (set by the checker)
+};
+
+
+// NOTE: an expression t0 op0 t1 op1 ... tn is stored flat (its parts
+// are contiguous in ASTArena::expr_parts) and, as MyPL has no operator
+// precedence, is evaluated right to left: t0 op0 (t1 op1 (... tn))
+
+class Expr
+{
+public:
+  NodeIndex first = NULL_NODE;         // index into ASTArena::expr_parts
+  NodeIndex count = 0;                 // number of parts (terms)
   void accept(Visitor& v) { v.visit(*this); }  
-  Token first_token() {return first->first_token();}
 };
 
-class SimpleTerm : public ExprTerm
+class SimpleTerm
 {
 public:
-  std::shared_ptr<RValue> rvalue = nullptr;
+  RValueRef rvalue;
   void accept(Visitor& v) { v.visit(*this); }
-  Token first_token() {return rvalue->first_token();}
 };
 
 
-class ComplexTerm : public ExprTerm
+class ComplexTerm
 {
 public:
   Expr expr;
   void accept(Visitor& v) { v.visit(*this); }      
-  Token first_token() {return expr.first_token();}
 };
 
 
-class SimpleRValue : public RValue
+class SimpleRValue
 {
 public:
   Token value;
@@ -203,7 +253,7 @@ public:
 };
 
 
-class NewRValue : public RValue
+class NewRValue
 {
 public:
   Token type;
@@ -213,6 +263,10 @@ public:
 };
 
 
+// NOTE: access and slot are set by the semantic checker, where the
+// slot is the frame slot of a variable (the first path element) or the
+// index of a struct field
+
 class VarRef
 {
 public:
@@ -220,10 +274,12 @@ public:
   bool is_method = false;
   std::optional<Expr> array_expr = std::nullopt; 
   std::vector<std::optional<Expr>> method_params = {};
+  AccessKind access = AccessKind::UNKNOWN;
+  int slot = -1;
 };
 
 
-class VarRValue : public RValue
+class VarRValue
 {
 public:
   std::vector<VarRef> path;
@@ -237,7 +293,7 @@ public:
 //----------------------------------------------------------------------
 
 
-class ReturnStmt : public Stmt
+class ReturnStmt
 {
 public:
   Expr expr;
@@ -245,25 +301,26 @@ public:
 };
 
 
-class WhileStmt : public Stmt
+class WhileStmt
 {
 public:
   Expr condition;
-  std::vector<std::shared_ptr<Stmt>> stmts;
+  std::vector<StmtRef> stmts;
   void accept(Visitor& v) { v.visit(*this); }  
 };
 
 
-class VarDeclStmt : public Stmt
+class VarDeclStmt
 {
 public:
   VarDef var_def;
   Expr expr;
+  int slot = -1;                       // frame slot (set by the checker)
   void accept(Visitor& v) { v.visit(*this); }  
 };
 
 
-class AssignStmt : public Stmt
+class AssignStmt
 {
 public:
   std::vector<VarRef> lvalue;
@@ -272,13 +329,13 @@ public:
 };
 
 
-class ForStmt : public Stmt
+class ForStmt
 {
 public:
   VarDeclStmt var_decl;
   Expr condition;
   AssignStmt assign_stmt;
-  std::vector<std::shared_ptr<Stmt>> stmts;
+  std::vector<StmtRef> stmts;
   void accept(Visitor& v) { v.visit(*this); }  
 };
 
@@ -287,21 +344,23 @@ class BasicIf
 {
 public:
   Expr condition;
-  std::vector<std::shared_ptr<Stmt>> stmts;
+  std::vector<StmtRef> stmts;
 };
 
 
-class IfStmt : public Stmt
+class IfStmt
 {
 public:
   BasicIf if_part;
   std::vector<BasicIf> else_ifs;
-  std::vector<std::shared_ptr<Stmt>> else_stmts;
+  std::vector<StmtRef> else_stmts;
   void accept(Visitor& v) { v.visit(*this); }  
 };
 
 
-class CallExpr : public Stmt, public RValue
+// call expressions are both statements and rvalues (both kinds of
+// handle index into the same pool)
+class CallExpr
 {
 public:
   Token fun_name;
@@ -311,4 +370,149 @@ public:
 };
 
 
+//----------------------------------------------------------------------
+// Node arena
+//----------------------------------------------------------------------
+
+
+class ASTArena
+{
+public:
+
+  // per-kind node pools
+  std::vector<ReturnStmt> return_stmts;
+  std::vector<WhileStmt> while_stmts;
+  std::vector<ForStmt> for_stmts;
+  std::vector<IfStmt> if_stmts;
+  std::vector<VarDeclStmt> var_decl_stmts;
+  std::vector<AssignStmt> assign_stmts;
+  std::vector<CallExpr> call_exprs;
+  std::vector<SimpleTerm> simple_terms;
+  std::vector<ComplexTerm> complex_terms;
+  std::vector<SimpleRValue> simple_rvalues;
+  std::vector<NewRValue> new_rvalues;
+  std::vector<VarRValue> var_rvalues;
+  std::vector<ExprPart> expr_parts;
+
+  // saved tokens of function bodies not yet parsed
+  std::vector<Token> body_tokens;
+
+  // move a finished node into its pool, returning its handle
+  StmtRef add(ReturnStmt&& s);
+  StmtRef add(WhileStmt&& s);
+  StmtRef add(ForStmt&& s);
+  StmtRef add(IfStmt&& s);
+  StmtRef add(VarDeclStmt&& s);
+  StmtRef add(AssignStmt&& s);
+  StmtRef add_stmt(CallExpr&& e);
+  TermRef add(SimpleTerm&& t);
+  TermRef add(ComplexTerm&& t);
+  RValueRef add(SimpleRValue&& v);
+  RValueRef add(NewRValue&& v);
+  RValueRef add(VarRValue&& v);
+  RValueRef add_rvalue(CallExpr&& e);
+  Expr add(const std::vector<ExprPart>& parts);
+
+  // the parts of an expression (valid until more parts are added)
+  std::span<ExprPart> parts(const Expr& e);
+
+  // dispatch the visitor to the node a handle refers to
+  void accept(const StmtRef& ref, Visitor& v);
+  void accept(const TermRef& ref, Visitor& v);
+  void accept(const RValueRef& ref, Visitor& v);
+
+  // helpers to return the first token of an expression (or term or
+  // rvalue)
+  Token first_token(const Expr& e);
+  Token first_token(const TermRef& ref);
+  Token first_token(const RValueRef& ref);
+
+  // release every node
+  void clear();
+
+};
+
+
+//----------------------------------------------------------------------
+// Definition index
+//----------------------------------------------------------------------
+
+// Hashed lookup of the program's struct, function, and class
+// definitions (and their fields, members, and methods). Built once
+// after parsing and shared by every pass; entries point into the
+// Program's definition vectors.
+
+class DefIndex
+{
+public:
+
+  // index the definitions of the given program (for duplicate struct
+  // and class names the first definition wins, for functions the last)
+  void build(Program& p);
+
+  // top-level definitions (nullptr if no such name)
+  const StructDef* get_struct(const std::string& name) const;
+  const FunDef* get_function(const std::string& name) const;
+  FunDef* get_function(const std::string& name);
+  const ClassDef* get_class(const std::string& name) const;
+
+  // the field of a struct (nullptr if no such field)
+  const VarDef* get_field(const StructDef& struct_def,
+                          const std::string& field_name) const;
+
+  // the public or private member/method of a class (nullptr if the
+  // class has no such member/method with the given visibility)
+  const VarDef* get_member(const ClassDef& class_def,
+                           const std::string& member_name,
+                           bool is_public) const;
+  const FunDef* get_method(const ClassDef& class_def,
+                           const std::string& method_name,
+                           bool is_public) const;
+
+private:
+
+  class ClassEntry
+  {
+  public:
+    const ClassDef* def = nullptr;
+    std::unordered_map<std::string, const VarDef*> public_members;
+    std::unordered_map<std::string, const VarDef*> private_members;
+    std::unordered_map<std::string, const FunDef*> public_methods;
+    std::unordered_map<std::string, const FunDef*> private_methods;
+  };
+
+  class StructEntry
+  {
+  public:
+    const StructDef* def = nullptr;
+    std::unordered_map<std::string, const VarDef*> fields;
+  };
+
+  std::unordered_map<std::string, StructEntry> structs;
+  std::unordered_map<std::string, FunDef*> functions;
+  std::unordered_map<std::string, ClassEntry> classes;
+
+};
+
+
+// NOTE: a program is move-only since its definition index points into
+// its own definition vectors
+
+class Program : public ASTNode
+{
+public:
+  std::vector<StructDef> struct_defs;
+  std::vector<FunDef> fun_defs;
+  std::vector<ClassDef> class_defs;
+  ASTArena arena;
+  DefIndex defs;
+  Program() = default;
+  Program(Program&&) = default;
+  Program& operator=(Program&&) = default;
+  Program(const Program&) = delete;
+  Program& operator=(const Program&) = delete;
+  void accept(Visitor& v) { v.visit(*this); }
+};
+
+
 #endif
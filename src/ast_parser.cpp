@@ -11,14 +11,26 @@
 using namespace std;
 
 
-ASTParser::ASTParser(const Lexer& a_lexer)
-  : lexer {a_lexer}
+ASTParser::ASTParser(const Lexer& a_lexer, bool a_lazy_bodies)
+  : lexer {a_lexer}, lazy_bodies {a_lazy_bodies}
+{}
+
+ASTParser::ASTParser(PipelinedLexer& tokens, bool a_lazy_bodies)
+  : pipeline {&tokens}, lazy_bodies {a_lazy_bodies}
 {}
 
 
 void ASTParser::advance()
 {
-  curr_token = lexer.next_token();
+  if (replay_pos < replay_end)
+    curr_token = arena.body_tokens[replay_pos++];
+  else if (pipeline)
+    curr_token = pipeline->next_token();
+  else if (lexer)
+    curr_token = lexer->next_token();
+  else
+    curr_token = Token(TokenType::EOS, "end-of-stream", curr_token.line(),
+                       curr_token.column());
 }
 
 
@@ -94,19 +106,19 @@ Program ASTParser::parse()
   while (!match(TokenType::EOS)) {
     if (match(TokenType::STRUCT))
       struct_def(p);
-    else if(match(TokenType::CLASS))
+    else if(match(TokenType::CLASS)){
       class_def(p);
-    else
-      fun_def(p);
-    //add class methods to fun_defs
-    for(auto &c : p.class_defs){
-      for(auto &m : c.public_methods){
+      //add (only the new) class methods to fun_defs
+      for(auto &m : p.class_defs.back().public_methods){
         p.fun_defs.push_back(m);
-        
       }
-    }
+    }else
+      fun_def(p);
   }
   eat(TokenType::EOS, "expecting end-of-file");
+  p.arena = std::move(arena);
+  //index the definitions once for all later passes
+  p.defs.build(p);
   return p;
 }
 
@@ -173,6 +185,23 @@ void ASTParser::fun_def(Program &p)
 
   //check for lbrace
   eat(TokenType::LBRACE, "Expected lbrace");
+  //parse (or just save) the body
+  if(lazy_bodies){
+    skip_body(f);
+  }else{
+    fun_body(f);
+  }
+  
+  p.fun_defs.push_back(f);
+}
+
+/*Input: FunDef &f
+* Output: void
+* Function that parses function body statements
+* (after the lbrace) and adds to AST
+*/
+void ASTParser::fun_body(FunDef &f)
+{
   while(!match(TokenType::RBRACE) && !match(TokenType::EOS)){// if not empty string, loop (checking for EOS)
     stmt(f.stmts);//check for stmt
     
@@ -183,8 +212,56 @@ void ASTParser::fun_def(Program &p)
   }
   //check for rbrace
   eat(TokenType::RBRACE, "Expected rbrace");
-  
-  p.fun_defs.push_back(f);
+}
+
+/*Input: FunDef &f
+* Output: void
+* Function that pre-parses a function body, saving its
+* tokens (through the matching rbrace) for parse_body
+*/
+void ASTParser::skip_body(FunDef &f)
+{
+  f.body_begin = arena.body_tokens.size();
+  int depth = 0;
+  while(depth > 0 || !match(TokenType::RBRACE)){
+    if(match(TokenType::EOS)){//if EOS, throw error
+      error("EOS before rbrace in function");
+    }
+    if(match(TokenType::LBRACE)){
+      ++depth;
+    }else if(match(TokenType::RBRACE)){
+      --depth;
+    }
+    arena.body_tokens.push_back(curr_token);
+    advance();
+  }
+  //keep the closing rbrace so the body parse ends on it
+  arena.body_tokens.push_back(curr_token);
+  f.body_end = arena.body_tokens.size();
+  eat(TokenType::RBRACE, "Expected rbrace");
+}
+
+
+void ASTParser::parse_body(ASTArena& arena, FunDef& f)
+{
+  if(!f.lazy_body()){
+    return;
+  }
+  //parse into the program's arena (moved in and back out)
+  ASTParser parser;
+  parser.arena = std::move(arena);
+  parser.replay_pos = f.body_begin;
+  parser.replay_end = f.body_end;
+  f.body_begin = NULL_NODE;
+  f.body_end = NULL_NODE;
+  try {
+    parser.advance();
+    parser.fun_body(f);
+  } catch (MyPLException& ex) {
+    arena = std::move(parser.arena);
+    throw;
+  }
+  arena = std::move(parser.arena);
 }
 
 /*Input: StructDef &s
@@ -335,16 +412,12 @@ void ASTParser::class_method(FunDef& f){
 
   //check for lbrace
   eat(TokenType::LBRACE, "Expected lbrace");
-  while(!match(TokenType::RBRACE) && !match(TokenType::EOS)){// if not empty string, loop (checking for EOS)
-    stmt(f.stmts);//check for stmt
-    
-  }
-  if(match(TokenType::EOS)){//if EOS, throw error
-    error("EOS before rbrace in function");
-
+  //parse (or just save) the body
+  if(lazy_bodies){
+    skip_body(f);
+  }else{
+    fun_body(f);
   }
-  //check for rbrace
-  eat(TokenType::RBRACE, "Expected rbrace");
 }
 
 /*Input: VarDef &v
@@ -429,48 +502,46 @@ void ASTParser::params(FunDef &f){
   }
 }
 
-/*Input: vector of shared ptrs to stmts
+/*Input: vector of stmt handles
 * Output: void
 * Function that parses statements and 
 * adds to AST 
 */
-void ASTParser::stmt(vector<std::shared_ptr<Stmt>> &stmts){
+void ASTParser::stmt(vector<StmtRef> &stmts){
   //check first token
   if(match(TokenType::IF)){//check for IF token
 
   //new if stmt
     IfStmt i;
     if_stmt(i);//check for IF statement
-    //make ptr tp of stmt
-    shared_ptr<IfStmt> i_ptr = make_shared<IfStmt>(i);
     //push back if stmt
-    stmts.push_back(i_ptr);
+    stmts.push_back(arena.add(std::move(i)));
 
   }else if(match(TokenType::WHILE)){//check for WHILE token
 
-    //create ptr to while stmt
-    shared_ptr<WhileStmt> w_ptr = make_shared<WhileStmt>();
-    while_stmt(*w_ptr);//check for WHILE statement
+    //new while stmt
+    WhileStmt w;
+    while_stmt(w);//check for WHILE statement
 
     //add while stmt to stmts
-    stmts.push_back(w_ptr);
+    stmts.push_back(arena.add(std::move(w)));
 
   }else if(match(TokenType::FOR)){//check for FOR token
 
-    //pointer to for_stmt
-    shared_ptr<ForStmt> f_ptr = make_shared<ForStmt>();
-    for_stmt(*f_ptr);//check for FOR statement
+    //new for stmt
+    ForStmt f;
+    for_stmt(f);//check for FOR statement
 
     //add for stmt to stmts
-    stmts.push_back(f_ptr);
+    stmts.push_back(arena.add(std::move(f)));
 
   }else if(match(TokenType::RETURN)){//check for RETURN token
 
-  //pointer to ret stmt
-    shared_ptr<ReturnStmt> r_ptr = make_shared<ReturnStmt>();
-    ret_stmt(*r_ptr);//check for RETURN statement
+    //new ret stmt
+    ReturnStmt r;
+    ret_stmt(r);//check for RETURN statement
     //add ret stmt to stmts
-    stmts.push_back(r_ptr);
+    stmts.push_back(arena.add(std::move(r)));
 
   }else if(match(TokenType::ID)){//if ID, check further (k = 1)
 
@@ -481,14 +552,14 @@ void ASTParser::stmt(vector<std::shared_ptr<Stmt>> &stmts){
     //check if next token is lparen
     if(match(TokenType::LPAREN)){
 
-      //point to callexpr
-      shared_ptr<CallExpr> c_ptr = make_shared<CallExpr>();
+      //new callexpr
+      CallExpr c;
       //assign temp to fun name
-      c_ptr->fun_name = temp;
-      call_expr(*c_ptr);
+      c.fun_name = temp;
+      call_expr(c);
 
       //add to stmts
-      stmts.push_back(c_ptr);
+      stmts.push_back(arena.add_stmt(std::move(c)));
       
     }else if(match(TokenType::ID)){
    
@@ -506,11 +577,8 @@ void ASTParser::stmt(vector<std::shared_ptr<Stmt>> &stmts){
       //pass in vdecl stmt
       vdecl_stmt(vd);
 
-      //point to vdecl stmt
-      shared_ptr<VarDeclStmt> vd_ptr = make_shared<VarDeclStmt>(vd);
-
       //add vdecl stmt to stmts
-      stmts.push_back(vd_ptr);
+      stmts.push_back(arena.add(std::move(vd)));
 
     }else if(match(TokenType::DOT) || match(TokenType::LBRACKET) || match(TokenType::ASSIGN)){
 
@@ -524,10 +592,8 @@ void ASTParser::stmt(vector<std::shared_ptr<Stmt>> &stmts){
       //if dot, lbracket, or assign token, check for assign stmt
       assign_stmt(a);
 
-      //point to vdecl stmt
-      shared_ptr<AssignStmt> a_ptr = make_shared<AssignStmt>(a);
       //push back assign stmt
-      stmts.push_back(a_ptr);
+      stmts.push_back(arena.add(std::move(a)));
       
     }else{//else throw error
       error("Invalid token after ID in stmt");
@@ -545,11 +611,9 @@ void ASTParser::stmt(vector<std::shared_ptr<Stmt>> &stmts){
     vd.var_def = v;
     //check for vdecl stmt
     vdecl_stmt(vd);
-    //point to vdecl stmt
-    shared_ptr<VarDeclStmt> vd_ptr = make_shared<VarDeclStmt>(vd);
 
     //add vdecl stmt to stmts
-    stmts.push_back(vd_ptr);
+    stmts.push_back(arena.add(std::move(vd)));
 
   }
 }
@@ -862,52 +926,54 @@ void ASTParser::ret_stmt(ReturnStmt &r){
 */
 void ASTParser::expr(Expr &e){
 
-  //check if NOT token
-  if(match(TokenType::NOT)){
-
-    //set 'negated' to true
-    e.negated = true;
-    //eat not token
-    advance();
-
-    expr(e);//check for expr
-    
+  //parse the terms and operators of the expression iteratively (only
+  //parenthesized sub-expressions recurse)
+  vector<ExprPart> parts;
+  while(true){
+    ExprPart part;
+
+    //check if NOT token(s)
+    while(match(TokenType::NOT)){
+      //set 'negated' to true
+      part.negated = true;
+      //eat not token
+      advance();
+    }
 
-  }else if(match(TokenType::LPAREN)){//check if lparen
+    if(match(TokenType::LPAREN)){//check if lparen
 
-    //create complexTerm shared ptr
-    shared_ptr<ComplexTerm> c_ptr = make_shared<ComplexTerm>();
-    //eat lparen
-    advance();
-    //check for expr, pass in shared ptr's expr
-    expr(c_ptr->expr);
-    //add shared ptr as 'first' expr in expr e
-    e.first = c_ptr;
-    eat(TokenType::RPAREN, "Expected rparen");
+      //create complexTerm
+      ComplexTerm c;
+      //eat lparen
+      advance();
+      //check for expr, pass in complex term's expr
+      expr(c.expr);
+      //add complex term as this part's term
+      part.term = arena.add(std::move(c));
+      eat(TokenType::RPAREN, "Expected rparen");
 
-  }else{// if not NOT or lparen, check for rvalue
+    }else{// if not NOT or lparen, check for rvalue
 
-    //create simpleterm
-    SimpleTerm s;
-    rvalue(s);
-    //add simple term ptr
-    e.first = make_shared<SimpleTerm>(s);
-    
-  }
-  //check for bin op
-  if(bin_op()){
+      //create simpleterm
+      SimpleTerm s;
+      rvalue(s);
+      //add simple term
+      part.term = arena.add(std::move(s));
 
-    //assign to expr's op
-    e.op = curr_token;
+    }
+    //check for bin op
+    if(!bin_op()){
+      parts.push_back(part);
+      break;
+    }
+    //assign to part's op
+    part.op = curr_token;
     //eat bin op
     advance();
- 
-    //assign expr r to be rest
-    e.rest = make_shared<Expr>();
-    //check for expr
-    expr(*e.rest);
-
+    parts.push_back(part);
   }
+  //store the parts contiguously
+  e = arena.add(parts);
 }
 
 /*Input: SimpleTerm &s
@@ -923,8 +989,8 @@ void ASTParser::rvalue(SimpleTerm &s){
     //create new simple rvalue to point to
     SimpleRValue r;
     r.value = curr_token;
-    //point to simple rvalue
-    s.rvalue = make_shared<SimpleRValue>(r);
+    //add simple rvalue
+    s.rvalue = arena.add(std::move(r));
    
     advance();//eat null
 
@@ -932,7 +998,7 @@ void ASTParser::rvalue(SimpleTerm &s){
 
     NewRValue n;
     new_rvalue(n);//check for new rvalue
-    s.rvalue = make_shared<NewRValue>(n);
+    s.rvalue = arena.add(std::move(n));
     
   }else if(match(TokenType::ID)){//else check for ID (k=2)
 
@@ -949,8 +1015,8 @@ void ASTParser::rvalue(SimpleTerm &s){
       c.fun_name = temp;
       //check for call expr
       call_expr(c);
-      //point to call expr
-      s.rvalue = make_shared<CallExpr>(c);
+      //add call expr
+      s.rvalue = arena.add_rvalue(std::move(c));
 
     }else{//otherwise check for var_rvalue
 
@@ -963,7 +1029,7 @@ void ASTParser::rvalue(SimpleTerm &s){
       v.path.push_back(vr);
       var_rvalue(v);
       //add varrvalue to simpleterm
-      s.rvalue = make_shared<VarRValue>(v);
+      s.rvalue = arena.add(std::move(v));
 
     }
 
@@ -972,8 +1038,8 @@ void ASTParser::rvalue(SimpleTerm &s){
     //make new simplervalue
     SimpleRValue r;
     r.value = curr_token;
-    //point to simplervalue
-    s.rvalue = make_shared<SimpleRValue>(r);
+    //add simplervalue
+    s.rvalue = arena.add(std::move(r));
     advance();
 
   }else {//otherwise throw error
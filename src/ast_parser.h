@@ -8,8 +8,10 @@
 #ifndef AST_PARSER_H
 #define AST_PARSER_H
 
+#include <optional>
 #include "mypl_exception.h"
 #include "lexer.h"
+#include "pipelined_lexer.h"
 #include "ast.h"
 
 
@@ -17,16 +19,38 @@ class ASTParser
 {
 public:
 
-  // create a new recursive descent parer
-  ASTParser(const Lexer& lexer);
+  // create a new recursive descent parer (if lazy_bodies is set,
+  // function bodies are only pre-parsed: their tokens are saved in the
+  // arena and parsed later by parse_body)
+  ASTParser(const Lexer& lexer, bool lazy_bodies = false);
+
+  // create a parser reading tokens from a lexer running on another
+  // thread
+  ASTParser(PipelinedLexer& tokens, bool lazy_bodies = false);
 
   // run the parser
   Program parse();
+
+  // parse a pre-parsed function body into the given arena (no-op if
+  // the body was already parsed)
+  static void parse_body(ASTArena& arena, FunDef& f);
   
 private:
   
-  Lexer lexer;
+  std::optional<Lexer> lexer;
+  PipelinedLexer* pipeline = nullptr;
   Token curr_token;
+  bool lazy_bodies = false;
+
+  // saved body tokens being replayed (instead of the lexer)
+  NodeIndex replay_pos = 0;
+  NodeIndex replay_end = 0;
+
+  // node storage for the program being parsed (moved into the Program)
+  ASTArena arena;
+
+  // parser over saved body tokens only
+  ASTParser() = default;
   
   // helper functions
   void advance();
@@ -47,7 +71,9 @@ private:
   void class_method(FunDef& f);
   void data_type(VarDef &v);
   void params(FunDef &f);
-  void stmt(std::vector<std::shared_ptr<Stmt>> &s);
+  void fun_body(FunDef &f);
+  void skip_body(FunDef &f);
+  void stmt(std::vector<StmtRef> &s);
   void vdecl_stmt(VarDeclStmt& vd);
   void assign_stmt(AssignStmt &s);
   void lvalue(AssignStmt &s);
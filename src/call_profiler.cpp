@@ -0,0 +1,152 @@
+//----------------------------------------------------------------------
+// FILE: call_profiler.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the function-level call profiler
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <iomanip>
+#include "call_profiler.h"
+
+using namespace std;
+
+
+void CallProfiler::start(const VMFrame& main)
+{
+  activations.clear();
+  depths.clear();
+  edge_depths.clear();
+  enter(main, nullptr, profile_ticks());
+}
+
+
+void CallProfiler::call(const VMFrame& caller, const VMFrame& callee)
+{
+  long now = profile_ticks();
+  EdgeStats& edge = edge_stats[{caller.info.function_name,
+                                callee.info.function_name}];
+  ++edge.calls;
+  // the caller's pc is just past the call
+  const VMLineEntry* pos = source_position(caller.info, caller.pc - 1);
+  if (pos)
+    edge.line = pos->line;
+  enter(callee, &edge, now);
+}
+
+
+void CallProfiler::ret(const VMFrame& frame)
+{
+  leave(profile_ticks());
+}
+
+
+void CallProfiler::end()
+{
+  long now = profile_ticks();
+  while (!activations.empty())
+    leave(now);
+}
+
+
+void CallProfiler::enter(const VMFrame& frame, EdgeStats* edge, long now)
+{
+  FunctionStats& f = function_stats[frame.info.function_name];
+  ++f.calls;
+  if (!frame.info.line_table.empty())
+    f.line = frame.info.line_table[0].line;
+  int depth = ++depths[&f];
+  f.max_depth = max(f.max_depth, depth);
+  if (edge)
+    ++edge_depths[edge];
+  activations.push_back({&f, edge, now});
+}
+
+
+void CallProfiler::leave(long now)
+{
+  Activation a = activations.back();
+  activations.pop_back();
+  long inclusive = now - a.start;
+  a.function->exclusive += inclusive - a.callee_ticks;
+  // time of recursive calls (and recursive edges) is already in the
+  // outermost call's time
+  if (--depths[a.function] == 0)
+    a.function->inclusive += inclusive;
+  if (a.edge and --edge_depths[a.edge] == 0)
+    a.edge->inclusive += inclusive;
+  if (!activations.empty())
+    activations.back().callee_ticks += inclusive;
+}
+
+
+void CallProfiler::print(ostream& out) const
+{
+  long total = 0;
+  for (auto& [name, f] : function_stats)
+    total += f.exclusive;
+  auto percent = [total](long x) {
+    return total ? 100.0 * x / total : 0.0;
+  };
+
+  vector<const pair<const string, FunctionStats>*> sorted;
+  for (auto& entry : function_stats)
+    sorted.push_back(&entry);
+  stable_sort(sorted.begin(), sorted.end(), [](auto x, auto y) {
+    return x->second.inclusive > y->second.inclusive;
+  });
+
+  string unit = profile_tick_unit();
+  out << left << setw(20) << "function" << right << setw(10) << "calls"
+      << setw(16) << "incl " + unit << setw(8) << "%" << setw(16)
+      << "excl " + unit << setw(8) << "%" << setw(8) << "depth" << endl;
+  out << fixed << setprecision(1);
+  for (auto entry : sorted) {
+    const FunctionStats& f = entry->second;
+    out << left << setw(20) << entry->first << right << setw(10) << f.calls
+        << setw(16) << f.inclusive << setw(8) << percent(f.inclusive)
+        << setw(16) << f.exclusive << setw(8) << percent(f.exclusive)
+        << setw(8) << f.max_depth << endl;
+  }
+
+  vector<const pair<const pair<string, string>, EdgeStats>*> edges;
+  for (auto& entry : edge_stats)
+    edges.push_back(&entry);
+  stable_sort(edges.begin(), edges.end(), [](auto x, auto y) {
+    return x->second.calls > y->second.calls;
+  });
+  out << endl << "calls by caller -> callee:" << endl;
+  for (auto entry : edges) {
+    out << "  " << left << setw(36)
+        << entry->first.first + " -> " + entry->first.second << right
+        << setw(10) << entry->second.calls << setw(16)
+        << entry->second.inclusive << endl;
+  }
+}
+
+
+void CallProfiler::write_callgrind(ostream& out, const string& source_name) const
+{
+  string unit = profile_tick_unit();
+  out << "# callgrind format" << endl;
+  out << "version: 1" << endl;
+  out << "creator: mypl" << endl;
+  out << "positions: line" << endl;
+  out << "events: " << (unit == "cycles" ? "Cycles" : "Nanoseconds") << endl;
+  out << endl;
+  out << "fl=" << source_name << endl;
+  for (auto& [name, f] : function_stats) {
+    out << "fn=" << name << endl;
+    out << f.line << " " << f.exclusive << endl;
+    // the calls this function made (edges are sorted by caller)
+    auto edge = edge_stats.lower_bound({name, ""});
+    for (; edge != edge_stats.end() and edge->first.first == name; ++edge) {
+      const string& callee = edge->first.second;
+      out << "cfn=" << callee << endl;
+      out << "calls=" << edge->second.calls << " "
+          << function_stats.at(callee).line << endl;
+      out << edge->second.line << " " << edge->second.inclusive << endl;
+    }
+    out << endl;
+  }
+}
@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------
+// FILE: call_profiler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Function-level call counts and times of a VM run
+//----------------------------------------------------------------------
+
+#ifndef CALL_PROFILER_H
+#define CALL_PROFILER_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm_profiler.h"
+
+
+// Counts every call of each function with its inclusive time (with
+// callees, counting recursive calls once), exclusive time (without
+// callees), and deepest recursion, plus the calls along each caller to
+// callee edge, where times are in profile_ticks.
+
+class CallProfiler : public VMProfiler
+{
+public:
+
+  class FunctionStats
+  {
+  public:
+    long calls = 0;
+    long inclusive = 0;
+    long exclusive = 0;
+    // most activations of the function on the call stack at once
+    int max_depth = 0;
+    // source line of the function's first code (0 if not known)
+    int line = 0;
+  };
+
+  class EdgeStats
+  {
+  public:
+    long calls = 0;
+    long inclusive = 0;
+    // source line of the call (0 if not known)
+    int line = 0;
+  };
+
+  void start(const VMFrame& main) override;
+  void call(const VMFrame& caller, const VMFrame& callee) override;
+  void ret(const VMFrame& frame) override;
+  void end() override;
+
+  // the stats of each function and of each (caller, callee) edge
+  const std::map<std::string, FunctionStats>& functions() const
+  {return function_stats;}
+  const std::map<std::pair<std::string, std::string>, EdgeStats>& edges() const
+  {return edge_stats;}
+
+  // print the functions by inclusive time and the edges by calls
+  void print(std::ostream& out) const;
+
+  // write the stats in the callgrind format (for the named source)
+  void write_callgrind(std::ostream& out, const std::string& source_name) const;
+
+private:
+
+  std::map<std::string, FunctionStats> function_stats;
+  std::map<std::pair<std::string, std::string>, EdgeStats> edge_stats;
+
+  // a function call still running
+  class Activation
+  {
+  public:
+    FunctionStats* function;
+    EdgeStats* edge;            // nullptr for main
+    long start;
+    long callee_ticks = 0;
+  };
+  std::vector<Activation> activations;
+
+  // activations of each function on the stack
+  std::unordered_map<FunctionStats*, int> depths;
+  // activations of each call edge on the stack
+  std::unordered_map<EdgeStats*, int> edge_depths;
+
+  void enter(const VMFrame& frame, EdgeStats* edge, long now);
+  void leave(long now);
+
+};
+
+
+#endif
@@ -8,6 +8,7 @@
 #include <iostream>  
 #include <unordered_set>           // for debugging
 #include "code_generator.h"
+#include "work_pool.h"
 
 using namespace std;
 
@@ -19,27 +20,102 @@ void replace_all(string& s, const string& old_str, const string& new_str)
 }
 
 
-CodeGenerator::CodeGenerator(VM& vm)
-  : vm(vm)
+// pick the typed version of an arithmetic or comparison instruction
+// for the operand type found by the checker (generic if not int/double)
+VMInstr typed(const DataType& t, VMInstr generic, VMInstr int_instr,
+              VMInstr dbl_instr)
 {
+  if (t.is_array)
+    return generic;
+  if (t.type_name == "int")
+    return int_instr;
+  if (t.type_name == "double")
+    return dbl_instr;
+  return generic;
+}
+
+
+CodeGenerator::CodeGenerator(VM& vm, bool lazy, unsigned thread_count)
+  : vm(vm), lazy(lazy), thread_count(thread_count)
+{
+}
+
+
+void CodeGenerator::set_trace(TraceEvents& events)
+{
+  trace_events = &events;
 }
 
 
 void CodeGenerator::visit(Program& p)
 {
+  arena = &p.arena;
+  defs = &p.defs;
   for (auto& struct_def : p.struct_defs)
     struct_def.accept(*this);
   for (auto& class_def : p.class_defs)
     class_def.accept(*this);
-  for (auto& fun_def : p.fun_defs)
-    fun_def.accept(*this);
+  if (lazy) {
+    for (auto& fun_def : p.fun_defs)
+      vm.add_stub(fun_def.fun_name.lexeme(), fun_def.params.size());
+    // generate (and cache in the vm) a function's code on its first call
+    vm.set_frame_loader([this](const string& fun_name) {
+      defs->get_function(fun_name)->accept(*this);
+    });
+  }
+  else if (thread_count > 1)
+    generate_parallel(p.fun_defs);
+  else {
+    for (auto& fun_def : p.fun_defs)
+      fun_def.accept(*this);
+  }
+}
+
+
+void CodeGenerator::generate_parallel(vector<FunDef>& fun_defs)
+{
+  // one generator (and var table) per worker thread, each building
+  // frames that are then added to the vm in source order
+  vector<CodeGenerator> workers(thread_count, CodeGenerator(vm));
+  for (CodeGenerator& w : workers) {
+    w.arena = arena;
+    w.defs = defs;
+    w.trace_events = trace_events;
+  }
+  vector<VMFrameInfo> frames(fun_defs.size());
+  auto errors = WorkPool::run(fun_defs.size(), thread_count,
+                              [&](unsigned worker, size_t i) {
+    if (fun_defs[i].lazy_body())
+      return;
+    workers[worker].generate(fun_defs[i]);
+    frames[i] = std::move(workers[worker].curr_frame);
+  });
+  WorkPool::rethrow_first(errors);
+  for (size_t i = 0; i < fun_defs.size(); ++i) {
+    if (!fun_defs[i].lazy_body())
+      vm.add(frames[i]);
+  }
 }
 
 
 void CodeGenerator::visit(FunDef& f)
 { 
+  //bodies still pre-parsed were never reached from main by the checker
+  if(f.lazy_body()){
+    return;
+  }
+  generate(f);
+  //add frame info to vm
+  vm.add(curr_frame);
+}
+
+
+void CodeGenerator::generate(FunDef& f)
+{
+  double start = trace_events ? trace_events->now() : 0;
   //set curr frame
   curr_frame = VMFrameInfo {f.fun_name.lexeme(), (int)f.params.size()};
+  mark(f.fun_name);
   //push new env
   var_table.push_environment();
 
@@ -47,12 +123,12 @@ void CodeGenerator::visit(FunDef& f)
   for(int i = 0; i < f.params.size(); i++){
     curr_frame.instructions.push_back(VMInstr::STORE(i));
     //add to var table
-    var_table.add(f.params[i].var_name.lexeme());
+    var_table.add(f.params[i].var_name.symbol());
   }
 
   //visit body stmts
   for(auto& s : f.stmts){
-    s->accept(*this);
+    generate(s);
   }
   if(f.stmts.size() > 0){
     //check if last instruction is a return
@@ -68,21 +144,46 @@ void CodeGenerator::visit(FunDef& f)
   }
   //pop env
   var_table.pop_environment();
+  if(trace_events){
+    trace_events->span(f.fun_name.lexeme(), "codegen", start,
+                       trace_events->now() - start);
+  }
+}
 
-  //add frame info to vm
-  vm.add(curr_frame);
-
+void CodeGenerator::mark(const Token& t)
+{
+  vector<VMLineEntry>& table = curr_frame.line_table;
+  int pc = curr_frame.instructions.size();
+  auto same = [&](const VMLineEntry& e) {
+    return e.line == t.line() && e.column == t.column();
+  };
+  if(!table.empty() && table.back().pc == pc){
+    //no code came from the previous position
+    table.pop_back();
+  }
+  if(!table.empty() && same(table.back())){
+    return;
+  }
+  table.push_back({pc, t.line(), t.column()});
+}
 
+void CodeGenerator::generate(const StmtRef& s)
+{
+  arena->accept(s, *this);
+  //every call but print pushes a value
+  if(s.kind == StmtKind::CALL && arena->call_exprs[s.index].fun_name.lexeme() != "print"){
+    curr_frame.instructions.push_back(VMInstr::POP());
+  }
 }
 
 void CodeGenerator::visit(StructDef& s)
 {
-  struct_defs[s.struct_name.lexeme()] = s;//add struct to map
+  //nothing to generate (struct defs come from the program's def index)
 }
 
 void CodeGenerator::visit(ClassDef& c)
 {
-  class_defs[c.class_name.lexeme()] = c;//add class to map
+  //nothing to generate (class defs come from the program's def index)
 }
 
 void CodeGenerator::visit(ReturnStmt& s)
@@ -103,9 +204,11 @@ void CodeGenerator::visit(WhileStmt& s)
   int j = curr_frame.instructions.size() - 1;
   var_table.push_environment();
   for(auto &st : s.stmts){
-    st->accept(*this);//visit stmts
+    generate(st);//visit stmts
   }
   var_table.pop_environment();
+  //the loop control is at the condition
+  mark(arena->first_token(s.condition));
   curr_frame.instructions.push_back(VMInstr::JMP(i));//jmp to start
   curr_frame.instructions.push_back(VMInstr::NOP());//nop for end of loop
   int k = curr_frame.instructions.size(); //get current instr index
@@ -128,12 +231,13 @@ void CodeGenerator::visit(ForStmt& s)
   var_table.push_environment();
   //visit stmts
   for(auto &st : s.stmts){
-    st->accept(*this);
+    generate(st);
   }
   var_table.pop_environment();
   //visit assign stmt
   s.assign_stmt.accept(*this);
   var_table.pop_environment();
+  mark(arena->first_token(s.condition));
   curr_frame.instructions.push_back(VMInstr::JMP(i));//jmp to start
   curr_frame.instructions.push_back(VMInstr::NOP());// for end of loop
   int k = curr_frame.instructions.size();//get curr instr index
@@ -153,7 +257,7 @@ void CodeGenerator::visit(IfStmt& s)
   int i = curr_frame.instructions.size() - 1;
   //visit stmts
   for(auto &st : s.if_part.stmts){
-    st->accept(*this);
+    generate(st);
   }
   //add jmp with dummy val
   curr_frame.instructions.push_back(VMInstr::JMP(10));
@@ -171,7 +275,7 @@ void CodeGenerator::visit(IfStmt& s)
     i = curr_frame.instructions.size() - 1;
     //visit stmts
     for(auto &st : e.stmts){
-      st->accept(*this);
+      generate(st);
     }
     //add jmp with dummy val
     curr_frame.instructions.push_back(VMInstr::JMP(10));
@@ -185,7 +289,7 @@ void CodeGenerator::visit(IfStmt& s)
     //update previous jmpf
     curr_frame.instructions.at(i) = VMInstr::JMPF(j);
     for(auto &st : s.else_stmts){
-      st->accept(*this);
+      generate(st);
     }
   }
   curr_frame.instructions.push_back(VMInstr::NOP());//after if/elses
@@ -209,19 +313,24 @@ void CodeGenerator::visit(VarDeclStmt& s)
   //TODO: remove next var index
 
   //add to var table
-  var_table.add(s.var_def.var_name.lexeme());
+  var_table.add(s.var_def.var_name.symbol());
 
-  //add store instr for next ind
-  curr_frame.instructions.push_back(VMInstr::STORE(var_table.get(s.var_def.var_name.lexeme())));
+  //add store instr for the var's slot
+  mark(s.var_def.var_name);
+  int i = s.slot >= 0 ? s.slot : var_table.get(s.var_def.var_name.symbol());
+  curr_frame.instructions.push_back(VMInstr::STORE(i));
 }
 
 
 void CodeGenerator::visit(AssignStmt& s)
 {
   //get index of var
-  int i = var_table.get(s.lvalue[0].var_name.lexeme());
-  //load var
-  curr_frame.instructions.push_back(VMInstr::LOAD(i));
+  mark(s.lvalue[0].var_name);
+  int i = var_slot(s.lvalue[0]);
+  //load var (unless storing to it)
+  if(s.lvalue.size() > 1 || s.lvalue[0].array_expr.has_value()){
+    curr_frame.instructions.push_back(VMInstr::LOAD(i));
+  }
   
   if(s.lvalue[0].array_expr.has_value()){
     //visit array expr
@@ -234,46 +343,31 @@ void CodeGenerator::visit(AssignStmt& s)
   
   //get fields
   for(int i = 1; i < s.lvalue.size() - 1; i++){
-    curr_frame.instructions.push_back(VMInstr::DUP());
+    get_member(s.lvalue[i - 1], s.lvalue[i]);
     if(s.lvalue[i].array_expr.has_value()){
-      curr_frame.instructions.push_back(VMInstr::GETF(s.lvalue[i].var_name.lexeme()));
       //visit array expr
       s.lvalue[i].array_expr.value().accept(*this);
 
       curr_frame.instructions.push_back(VMInstr::GETI());
-
-    }else if(struct_defs.count(s.lvalue[i - 1].var_name.lexeme())){
-      
-      curr_frame.instructions.push_back(VMInstr::GETF(s.lvalue[i].var_name.lexeme()));
-    }else{
-
-      curr_frame.instructions.push_back(VMInstr::GETMEM(s.lvalue[i].var_name.lexeme()));
     }
   }
 
   if(s.lvalue.size() != 1 && s.lvalue.back().array_expr.has_value()){
-    curr_frame.instructions.push_back(VMInstr::GETF(s.lvalue.back().var_name.lexeme()));
+    get_member(s.lvalue[s.lvalue.size() - 2], s.lvalue.back());
     s.lvalue.back().array_expr.value().accept(*this);
 
   }
-  //else if(s.lvalue.size() != 1){
-  //   curr_frame.instructions.push_back(VMInstr::GETMEM(s.lvalue.back().var_name.lexeme()));
-  // }
 
   //visit expr
   s.expr.accept(*this);
 
+  mark(s.lvalue[0].var_name);
   if(s.lvalue.back().array_expr.has_value()){
     
     curr_frame.instructions.push_back(VMInstr::SETI());
 
   }else if(s.lvalue.size() > 1){
-    if(struct_defs.count(s.lvalue[s.lvalue.size() - 2].var_name.lexeme())){
-      
-      curr_frame.instructions.push_back(VMInstr::SETF(s.lvalue[s.lvalue.size() - 1].var_name.lexeme()));
-    }else{
-      curr_frame.instructions.push_back(VMInstr::SETMEM(s.lvalue[s.lvalue.size() - 1].var_name.lexeme()));
-    }
+    set_member(s.lvalue[s.lvalue.size() - 2], s.lvalue.back());
     
   }else{
     //store var
@@ -283,6 +377,51 @@ void CodeGenerator::visit(AssignStmt& s)
 }
 
 
+int CodeGenerator::var_slot(const VarRef& r) const
+{
+  if(r.slot >= 0){
+    return r.slot;
+  }
+  return var_table.get(r.var_name.symbol());
+}
+
+
+void CodeGenerator::get_member(const VarRef& prev, const VarRef& r)
+{
+  if(r.access == AccessKind::FIELD){
+    curr_frame.instructions.push_back(VMInstr::GETF_SLOT(r.slot));
+
+  }else if(r.access == AccessKind::MEMBER){
+    curr_frame.instructions.push_back(VMInstr::GETMEM(r.var_name.lexeme()));
+
+  }else if(r.array_expr.has_value() || defs->get_struct(prev.var_name.lexeme())){
+    //unchecked path (guess from the names)
+    curr_frame.instructions.push_back(VMInstr::GETF(r.var_name.lexeme()));
+
+  }else{
+    curr_frame.instructions.push_back(VMInstr::GETMEM(r.var_name.lexeme()));
+  }
+}
+
+
+void CodeGenerator::set_member(const VarRef& prev, const VarRef& r)
+{
+  if(r.access == AccessKind::FIELD){
+    curr_frame.instructions.push_back(VMInstr::SETF_SLOT(r.slot));
+
+  }else if(r.access == AccessKind::MEMBER){
+    curr_frame.instructions.push_back(VMInstr::SETMEM(r.var_name.lexeme()));
+
+  }else if(defs->get_struct(prev.var_name.lexeme())){
+    //unchecked path (guess from the names)
+    curr_frame.instructions.push_back(VMInstr::SETF(r.var_name.lexeme()));
+
+  }else{
+    curr_frame.instructions.push_back(VMInstr::SETMEM(r.var_name.lexeme()));
+  }
+}
+
+
 void CodeGenerator::visit(CallExpr& e)
 {
   //go through args
@@ -290,6 +429,7 @@ void CodeGenerator::visit(CallExpr& e)
     a.accept(*this);
   }
 
+  mark(e.fun_name);
   string f = e.fun_name.lexeme();
   //check for built in func
   if(f == "print"){
@@ -330,63 +470,70 @@ void CodeGenerator::visit(CallExpr& e)
 
 void CodeGenerator::visit(Expr& e)
 {
-  //visit first
-  e.first->accept(*this);
-
-  if(e.op.has_value()){
-    //visit rest
-    e.rest->accept(*this);
-
-    Token op_val = e.op.value();
-    //check which op
-    if(op_val.type() == TokenType::PLUS){
-      curr_frame.instructions.push_back(VMInstr::ADD());
+  span<ExprPart> parts = arena->parts(e);
+  //visit each term (left to right)
+  for(auto& part : parts){
+    mark(arena->first_token(part.term));
+    arena->accept(part.term, *this);
+  }
 
-    }else if(op_val.type() == TokenType::MINUS){
-      curr_frame.instructions.push_back(VMInstr::SUB());
+  //then apply the ops (and nots) from the innermost sub-expression out
+  for(int i = parts.size() - 1; i >= 0; i--){
+    if(parts[i].op.has_value()){
+      Token op_val = parts[i].op.value();
+      mark(op_val);
+      //operand type (the term's type, same as the rest's for these ops)
+      const DataType& t = parts[i].type;
+      //check which op
+      if(op_val.type() == TokenType::PLUS){
+        curr_frame.instructions.push_back(typed(t, VMInstr::ADD(), VMInstr::ADD_INT(), VMInstr::ADD_DBL()));
+
+      }else if(op_val.type() == TokenType::MINUS){
+        curr_frame.instructions.push_back(typed(t, VMInstr::SUB(), VMInstr::SUB_INT(), VMInstr::SUB_DBL()));
       
-    }else if(op_val.type() == TokenType::DIVIDE){
-      curr_frame.instructions.push_back(VMInstr::DIV());
+      }else if(op_val.type() == TokenType::DIVIDE){
+        curr_frame.instructions.push_back(typed(t, VMInstr::DIV(), VMInstr::DIV_INT(), VMInstr::DIV_DBL()));
       
-    }else if(op_val.type() == TokenType::TIMES){
-      curr_frame.instructions.push_back(VMInstr::MUL());
+      }else if(op_val.type() == TokenType::TIMES){
+        curr_frame.instructions.push_back(typed(t, VMInstr::MUL(), VMInstr::MUL_INT(), VMInstr::MUL_DBL()));
       
-    }else if(op_val.type() == TokenType::AND){
-      curr_frame.instructions.push_back(VMInstr::AND());
+      }else if(op_val.type() == TokenType::AND){
+        curr_frame.instructions.push_back(VMInstr::AND());
       
-    }else if(op_val.type() == TokenType::OR){
-      curr_frame.instructions.push_back(VMInstr::OR());
+      }else if(op_val.type() == TokenType::OR){
+        curr_frame.instructions.push_back(VMInstr::OR());
       
-    }else if(op_val.type() == TokenType::LESS){
-      curr_frame.instructions.push_back(VMInstr::CMPLT());
+      }else if(op_val.type() == TokenType::LESS){
+        curr_frame.instructions.push_back(typed(t, VMInstr::CMPLT(), VMInstr::CMPLT_INT(), VMInstr::CMPLT_DBL()));
       
-    }else if(op_val.type() == TokenType::GREATER){
-      curr_frame.instructions.push_back(VMInstr::CMPGT());
+      }else if(op_val.type() == TokenType::GREATER){
+        curr_frame.instructions.push_back(typed(t, VMInstr::CMPGT(), VMInstr::CMPGT_INT(), VMInstr::CMPGT_DBL()));
       
-    }else if(op_val.type() == TokenType::LESS_EQ){
-      curr_frame.instructions.push_back(VMInstr::CMPLE());
+      }else if(op_val.type() == TokenType::LESS_EQ){
+        curr_frame.instructions.push_back(typed(t, VMInstr::CMPLE(), VMInstr::CMPLE_INT(), VMInstr::CMPLE_DBL()));
       
-    }else if(op_val.type() == TokenType::GREATER_EQ){
-      curr_frame.instructions.push_back(VMInstr::CMPGE());
+      }else if(op_val.type() == TokenType::GREATER_EQ){
+        curr_frame.instructions.push_back(typed(t, VMInstr::CMPGE(), VMInstr::CMPGE_INT(), VMInstr::CMPGE_DBL()));
       
-    }else if(op_val.type() == TokenType::EQUAL){
-      curr_frame.instructions.push_back(VMInstr::CMPEQ());
+      }else if(op_val.type() == TokenType::EQUAL){
+        curr_frame.instructions.push_back(VMInstr::CMPEQ());
       
-    }else if(op_val.type() == TokenType::NOT_EQUAL){
-      curr_frame.instructions.push_back(VMInstr::CMPNE());
+      }else if(op_val.type() == TokenType::NOT_EQUAL){
+        curr_frame.instructions.push_back(VMInstr::CMPNE());
       
+      }
+    }
+    //check if negated
+    if(parts[i].negated){
+      curr_frame.instructions.push_back(VMInstr::NOT());
     }
-  }
-  //check if negated
-  if(e.negated){
-    curr_frame.instructions.push_back(VMInstr::NOT());
   }
 }
 
 
 void CodeGenerator::visit(SimpleTerm& t)
 {
-  t.rvalue->accept(*this);
+  arena->accept(t.rvalue, *this);
 }
  
 
@@ -435,12 +582,12 @@ void CodeGenerator::visit(NewRValue& v)
     //create and add ALLOCA
     curr_frame.instructions.push_back(VMInstr::ALLOCA());
 
-  }else if(struct_defs.count(v.type.lexeme())){//struct
+  }else if(defs->get_struct(v.type.lexeme())){//struct
     //create and add ALLOCS
-    curr_frame.instructions.push_back(VMInstr::ALLOCS());
+    curr_frame.instructions.push_back(VMInstr::ALLOCS(v.type.lexeme()));
 
-    //get struct from map
-    StructDef &s = struct_defs[v.type.lexeme()];
+    //get struct from index
+    const StructDef &s = *defs->get_struct(v.type.lexeme());
 
     for(auto &f : s.fields){
 
@@ -452,10 +599,12 @@ void CodeGenerator::visit(NewRValue& v)
     }
   }else{
     //create and add ALLOCC
-    curr_frame.instructions.push_back(VMInstr::ALLOCC());
+    curr_frame.instructions.push_back(VMInstr::ALLOCC(v.type.lexeme()));
 
-    //get class from map
-    ClassDef &c = class_defs[v.type.lexeme()];
+    //get class from index (an empty class if undefined)
+    static const ClassDef no_class;
+    const ClassDef *cp = defs->get_class(v.type.lexeme());
+    const ClassDef &c = cp ? *cp : no_class;
 
     for(auto &m : c.private_members){
       curr_frame.instructions.push_back(VMInstr::DUP());//dup obj id
@@ -487,7 +636,7 @@ void CodeGenerator::visit(NewRValue& v)
 void CodeGenerator::visit(VarRValue& v)
 {
   //get var index
-  int i = var_table.get(v.path[0].var_name.lexeme());
+  int i = var_slot(v.path[0]);
   //generate load instr
   curr_frame.instructions.push_back(VMInstr::LOAD(i));
 
@@ -499,25 +648,25 @@ void CodeGenerator::visit(VarRValue& v)
 
   //get fields and/or class members
   for(int i = 1; i < v.path.size(); i++){
-    curr_frame.instructions.push_back(VMInstr::DUP());
+    if(v.path[i].is_method){
+      //methods are called by name with just their args
+      curr_frame.instructions.push_back(VMInstr::POP());
+      for(auto& param : v.path[i].method_params){
+        if(param.has_value()){
+          param.value().accept(*this);
+        }
+      }
+      curr_frame.instructions.push_back(VMInstr::CALL(v.path[i].var_name.lexeme()));
+      continue;
+    }
+    get_member(v.path[i - 1], v.path[i]);
 
     if(v.path[i].array_expr.has_value()){
-      curr_frame.instructions.push_back(VMInstr::GETF(v.path[i].var_name.lexeme()));
       //visit array expr
       v.path[i].array_expr.value().accept(*this);
       //get i
       curr_frame.instructions.push_back(VMInstr::GETI());
-    }else if(struct_defs.count(v.path[i - 1].var_name.lexeme())){
-
-      curr_frame.instructions.push_back(VMInstr::GETF(v.path[i].var_name.lexeme()));
-    }else{
-      curr_frame.instructions.push_back(VMInstr::GETMEM(v.path[i].var_name.lexeme()));
     }
   }
-  //check for method call
-  if(v.path.back().is_method){
-    curr_frame.instructions.push_back(VMInstr::CALL(v.path.back().var_name.lexeme()));
-  }
 }
   
-
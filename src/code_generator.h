@@ -14,11 +14,16 @@
 #include "ast.h"
 #include "var_table.h"
 #include "vm.h"
+#include "trace_events.h"
 
 
 class CodeGenerator : public Visitor {
 public:
-  CodeGenerator(VM& vm);
+  // if lazy is set, the vm gets a stub per function and each function's
+  // code is generated on its first call (the program must outlive the
+  // vm run), otherwise function bodies are generated on thread_count
+  // worker threads
+  CodeGenerator(VM& vm, bool lazy = false, unsigned thread_count = 1);
   void visit(Program& p);
   void visit(FunDef& f);
   void visit(StructDef& s);
@@ -37,14 +42,43 @@ public:
   void visit(NewRValue& v);
   void visit(VarRValue& v);    
 
+  // add a span for the generation of each function's code
+  void set_trace(TraceEvents& events);
+
 private:
 
   VM& vm;
+  ASTArena* arena = nullptr;
   VMFrameInfo curr_frame;
   int next_var_index = 0;  
   VarTable var_table;
-  std::unordered_map<std::string,StructDef> struct_defs;
-  std::unordered_map<std::string,ClassDef> class_defs;
+  DefIndex* defs = nullptr;
+  bool lazy = false;
+  unsigned thread_count = 1;
+  TraceEvents* trace_events = nullptr;
+
+  // generate the given function's frame into curr_frame
+  void generate(FunDef& f);
+
+  // generate a statement (dropping the value a call statement leaves
+  // on the operand stack)
+  void generate(const StmtRef& s);
+
+  // generate the frames of the given functions on the worker threads
+  void generate_parallel(std::vector<FunDef>& fun_defs);
+
+  // frame slot of the variable a path starts with (resolved by the
+  // checker, or from the var table in unchecked trees)
+  int var_slot(const VarRef& r) const;
+
+  // record that the code generated next comes from the token's
+  // position (in curr_frame's line table)
+  void mark(const Token& t);
+
+  // get/set the field or member r of the object on top of the stack,
+  // where prev is the path element the object came from
+  void get_member(const VarRef& prev, const VarRef& r);
+  void set_member(const VarRef& prev, const VarRef& r);
 
 };
 
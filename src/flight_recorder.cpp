@@ -0,0 +1,169 @@
+//----------------------------------------------------------------------
+// FILE: flight_recorder.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the VM flight recorder
+//----------------------------------------------------------------------
+
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "flight_recorder.h"
+#include "mypl_exception.h"
+
+using namespace std;
+
+
+const FlightRecorder* FlightRecorder::signal_recorder = nullptr;
+
+
+namespace {
+
+  // opcode names for the signal handler (which cannot build strings)
+  constexpr int OPCODE_COUNT = static_cast<int>(OpCode::NOP) + 1;
+  string opcode_names[OPCODE_COUNT];
+
+  // the text of an entry (without a newline)
+  string entry_text(const FlightRecorder::Entry& e)
+  {
+    const string& name = e.function->function_name;
+    if (e.event == FlightRecorder::Event::CALL)
+      return "-> " + name;
+    if (e.event == FlightRecorder::Event::RETURN)
+      return "<- " + name + "@" + to_string(e.pc);
+    return name + "@" + to_string(e.pc) + " " + to_string(e.opcode);
+  }
+
+  // async-signal-safe output helpers
+  void write_chars(const char* s, size_t n)
+  {
+    while (n > 0) {
+      ssize_t written = ::write(STDERR_FILENO, s, n);
+      if (written <= 0)
+        return;
+      s += written;
+      n -= written;
+    }
+  }
+  void write_chars(const char* s)
+  {
+    write_chars(s, strlen(s));
+  }
+  void write_number(unsigned long x)
+  {
+    char digits[24];
+    int i = sizeof(digits);
+    do {
+      digits[--i] = '0' + x % 10;
+      x /= 10;
+    } while (x > 0);
+    write_chars(digits + i, sizeof(digits) - i);
+  }
+
+}
+
+
+FlightRecorder::FlightRecorder(int capacity)
+{
+  resize(capacity);
+}
+
+
+void FlightRecorder::resize(int capacity)
+{
+  if (capacity < 1)
+    throw MyPLException::VMError("flight recorder capacity must be positive");
+  unsigned long size = 1;
+  while (size < capacity)
+    size *= 2;
+  entries.assign(size, {});
+  ring = entries.data();
+  mask = size - 1;
+  next = 0;
+}
+
+
+void FlightRecorder::clear()
+{
+  next = 0;
+}
+
+
+vector<FlightRecorder::Entry> FlightRecorder::recent() const
+{
+  unsigned long first = next > entries.size() ? next - entries.size() : 0;
+  vector<Entry> result;
+  for (unsigned long i = first; i < next; ++i)
+    result.push_back(entries[i & mask]);
+  return result;
+}
+
+
+void FlightRecorder::write(ostream& out) const
+{
+  vector<Entry> events = recent();
+  out << "last " << events.size() << " of " << next
+      << " VM events (oldest first):" << endl;
+  for (const Entry& e : events)
+    out << "  " << entry_text(e) << endl;
+}
+
+
+void FlightRecorder::dump_on_signal(int signal, const FlightRecorder& recorder)
+{
+  for (int i = 0; i < OPCODE_COUNT; ++i)
+    opcode_names[i] = to_string(static_cast<OpCode>(i));
+  signal_recorder = &recorder;
+  struct sigaction action {};
+  action.sa_handler = on_signal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(signal, &action, nullptr) != 0)
+    throw MyPLException::VMError("cannot handle the flight recorder signal");
+}
+
+
+void FlightRecorder::stop_dump_on_signal(int signal)
+{
+  ::signal(signal, SIG_DFL);
+  signal_recorder = nullptr;
+}
+
+
+void FlightRecorder::on_signal(int signal)
+{
+  const FlightRecorder* r = signal_recorder;
+  if (!r)
+    return;
+  // as in write (with only async-signal-safe calls)
+  unsigned long last = r->next;
+  std::atomic_signal_fence(std::memory_order_acquire);
+  unsigned long first = last > r->entries.size() ? last - r->entries.size() : 0;
+  write_chars("last ");
+  write_number(last - first);
+  write_chars(" of ");
+  write_number(last);
+  write_chars(" VM events (oldest first):\n");
+  for (unsigned long i = first; i < last; ++i) {
+    const Entry& e = r->entries[i & r->mask];
+    // never follow a null function (record publishes written entries only)
+    if (!e.function)
+      continue;
+    write_chars("  ");
+    if (e.event == Event::CALL)
+      write_chars("-> ");
+    else if (e.event == Event::RETURN)
+      write_chars("<- ");
+    write_chars(e.function->function_name.c_str());
+    if (e.event != Event::CALL) {
+      write_chars("@");
+      write_number(e.pc);
+    }
+    if (e.event == Event::INSTRUCTION) {
+      write_chars(" ");
+      write_chars(opcode_names[static_cast<int>(e.opcode)].c_str());
+    }
+    write_chars("\n");
+  }
+}
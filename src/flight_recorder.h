@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------
+// FILE: flight_recorder.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Ring buffer of the most recent events of a VM run
+//----------------------------------------------------------------------
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "vm_frame.h"
+
+
+// Keeps the last capacity events of a VM run (every executed
+// instruction plus each call and return) so the lead-up to a VM error
+// can be printed. Recording is a few stores into the ring plus the
+// index update, and is always on (see VM::flight_recorder).
+
+class FlightRecorder
+{
+public:
+
+  enum class Event : std::uint8_t {INSTRUCTION, CALL, RETURN};
+
+  class Entry
+  {
+  public:
+    // the VM's frame info of the function (which outlives its frames):
+    // the executing function, the callee of a call, or the caller
+    // returned to
+    const VMFrameInfo* function;
+    // the instruction's pc (the caller's next pc for a return)
+    int pc;
+    OpCode opcode;
+    Event event;
+  };
+
+  // keep the last capacity events (rounded up to a power of 2)
+  explicit FlightRecorder(int capacity = 64);
+
+  // change the capacity, dropping the recorded events
+  void resize(int capacity);
+  int capacity() const {return entries.size();}
+
+  // drop the recorded events
+  void clear();
+
+  // record an event
+  void record(const VMFrameInfo* function, int pc, OpCode opcode,
+              Event event = Event::INSTRUCTION)
+  {
+    Entry& e = ring[next & mask];
+    e.function = function;
+    e.pc = pc;
+    e.opcode = opcode;
+    e.event = event;
+    // publish the entry only once it is written (for the signal handler)
+    std::atomic_signal_fence(std::memory_order_release);
+    ++next;
+  }
+
+  // the number of events recorded since the last clear (of which the
+  // last capacity are kept)
+  unsigned long count() const {return next;}
+
+  // the kept events, oldest first
+  std::vector<Entry> recent() const;
+
+  // print the kept events, oldest first
+  void write(std::ostream& out) const;
+
+  // print the recorder's kept events to stderr whenever the signal
+  // arrives (the run continues, and events recorded while printing
+  // may be mixed in)
+  static void dump_on_signal(int signal, const FlightRecorder& recorder);
+
+  // stop printing a recorder on the signal
+  static void stop_dump_on_signal(int signal);
+
+  // do a run of the recorder's VM (run), printing the kept events to
+  // stderr on SIGUSR1 during the run and to err if the run throws (the
+  // exception is then rethrown), as every mypl run mode does
+  template<typename F>
+  void watch(F run, std::ostream& err) const;
+
+private:
+
+  std::vector<Entry> entries;
+  Entry* ring = nullptr;        // entries.data() (for record)
+  unsigned long mask = 0;
+  unsigned long next = 0;
+
+  // the recorder printed on a signal and its handler
+  static const FlightRecorder* signal_recorder;
+  static void on_signal(int signal);
+
+};
+
+
+template<typename F>
+void FlightRecorder::watch(F run, std::ostream& err) const
+{
+  dump_on_signal(SIGUSR1, *this);
+  try {
+    run();
+  } catch (...) {
+    stop_dump_on_signal(SIGUSR1);
+    if (count() > 0)
+      write(err);
+    throw;
+  }
+  stop_dump_on_signal(SIGUSR1);
+}
+
+
+#endif
@@ -479,7 +479,7 @@ Token Lexer::next_token()
     if((isspace(peek()) || ispunct(peek())) && peek() != '_'){
 
       myWord += ch;
-      return(Token(TokenType::ID, myWord, line, column));
+      return(Token(TokenType::ID, myWord, line, column, Symbols::intern(myWord)));
     }
 
 //if next char is letter, number, or _, continue
@@ -596,7 +596,7 @@ Token Lexer::next_token()
 
       }else{// everything else is an ID
 
-        return(Token(TokenType::ID, myWord, line, wordStart));
+        return(Token(TokenType::ID, myWord, line, wordStart, Symbols::intern(myWord)));
       }
 
     }
@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------
+// FILE: line_profiler.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the per-source-line profiler
+//----------------------------------------------------------------------
+
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include "line_profiler.h"
+
+using namespace std;
+
+
+void LineProfiler::instruction(const VMFrame& frame, const VMInstr& instr)
+{
+  long now = profile_ticks();
+  stop(now);
+  const VMLineEntry* pos = source_position(frame.info, frame.pc);
+  int line = pos ? pos->line : 0;
+  if (line >= counts.size()) {
+    counts.resize(line + 1, 0);
+    tick_totals.resize(line + 1, 0);
+  }
+  ++counts[line];
+  running = line;
+  start = now;
+}
+
+
+void LineProfiler::end()
+{
+  stop(profile_ticks());
+}
+
+
+void LineProfiler::stop(long now)
+{
+  if (running >= 0)
+    tick_totals[running] += now - start;
+  running = -1;
+}
+
+
+long LineProfiler::count(int line) const
+{
+  return line >= 0 and line < counts.size() ? counts[line] : 0;
+}
+
+
+long LineProfiler::ticks(int line) const
+{
+  return line >= 0 and line < tick_totals.size() ? tick_totals[line] : 0;
+}
+
+
+void LineProfiler::print(ostream& out, const string& source) const
+{
+  long total_count = accumulate(counts.begin(), counts.end(), 0L);
+  long total_ticks = accumulate(tick_totals.begin(), tick_totals.end(), 0L);
+  auto percent = [](long x, long total) {
+    return total ? 100.0 * x / total : 0.0;
+  };
+  auto print_counts = [&](int line) {
+    if (count(line) == 0) {
+      out << setw(50) << "";
+      return;
+    }
+    out << setw(12) << count(line) << setw(8)
+        << percent(count(line), total_count) << setw(16) << ticks(line)
+        << setw(8) << percent(ticks(line), total_ticks) << setw(6) << "";
+  };
+
+  out << right << setw(12) << "instrs" << setw(8) << "%" << setw(16)
+      << profile_tick_unit() << setw(8) << "%" << setw(6) << "" << "line"
+      << endl;
+  out << fixed << setprecision(1);
+  istringstream in(source);
+  string text;
+  for (int line = 1; getline(in, text); ++line) {
+    print_counts(line);
+    out << setw(4) << line << "  " << text << endl;
+  }
+  if (count(0)) {
+    print_counts(0);
+    out << "(unknown)" << endl;
+  }
+}
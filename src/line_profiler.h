@@ -0,0 +1,52 @@
+//----------------------------------------------------------------------
+// FILE: line_profiler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Per-source-line execution counts and times of a VM run
+//----------------------------------------------------------------------
+
+#ifndef LINE_PROFILER_H
+#define LINE_PROFILER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "vm_profiler.h"
+
+
+// Counts the instructions run for each line of the MyPL source and
+// their time (in profile_ticks), using the frames' line tables, where
+// line 0 collects the instructions without a known position.
+
+class LineProfiler : public VMProfiler
+{
+public:
+
+  void instruction(const VMFrame& frame, const VMInstr& instr) override;
+  void end() override;
+
+  // the number of instructions run for the line and their total time
+  long count(int line) const;
+  long ticks(int line) const;
+
+  // print the source annotated with the count and time of each line
+  void print(std::ostream& out, const std::string& source) const;
+
+private:
+
+  // counts and times by line
+  std::vector<long> counts;
+  std::vector<long> tick_totals;
+
+  // the line of the running instruction (-1 if none) and when it
+  // started
+  int running = -1;
+  long start = 0;
+
+  // stop timing the running instruction
+  void stop(long now);
+
+};
+
+
+#endif
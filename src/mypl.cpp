@@ -8,8 +8,11 @@
 // after parsing using AST parser, and the --check flag type cheks the code
 //-----------------------------------------------------------------------
 
+#include <csignal>
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 #include "lexer.h"
 #include "token.h"
 #include "simple_parser.h"
@@ -19,13 +22,28 @@
 #include "semantic_checker.h"
 #include "vm.h"
 #include "code_generator.h"
+#include "tree_shaker.h"
+#include "work_pool.h"
+#include "run_stats.h"
+#include "opcode_profiler.h"
+#include "stack_sampler.h"
+#include "line_profiler.h"
+#include "call_profiler.h"
+#include "trace_events.h"
+#include "allocation_profiler.h"
 
 using namespace std;
 
 //function prototypes
 void printOptions();
 void printHeaders(string args[]);
-void printInput(string flag, istream *input);
+void printInput(string flag, istream *input, string file_name = "stdin");
+void setTraceFilter(string flag, VM& vm);
+void runWithStats(string flag, istream *input);
+void writeSamples(string flag, const StackSampler& sampler);
+void profileLines(istream *input);
+void runWithTraceEvents(string flag, istream *input);
+void printHeapStats(string flag, const VM& vm);
 
 
 int main(int argc, char* argv[])
@@ -81,11 +99,11 @@ int main(int argc, char* argv[])
       // call printInput()
       if(argc == 3){
 
-        printInput(args[1], input);
+        printInput(args[1], input, args[2]);
 
       }else{// else if 2 arguments, no flag. call printInput()
 
-        printInput("", input);
+        printInput("", input, args[1]);
 
       }
       delete input;
@@ -134,6 +152,28 @@ void printOptions(){
   cout << "   --print  pretty prints program" << endl;
   cout << "   --check  statically checks program" << endl;
   cout << "   --ir     print intermediate (code) representation" << endl; 
+  cout << "   --lazy   runs program, compiling function bodies on first use" << endl;
+  cout << "   --parallel runs program, compiling functions on all cores" << endl;
+  cout << "   --trace[=fun][:first-last]  runs program, printing each" << endl;
+  cout << "            instruction (of fun, at pcs first to last)" << endl;
+  cout << "   --step[=fun][:first-last]  runs program, waiting for enter" << endl;
+  cout << "            before each instruction (of fun, at pcs first to last)" << endl;
+  cout << "   --stats[=file]  runs program, printing the time and allocations" << endl;
+  cout << "            of each phase and the execution counts (as JSON to file)" << endl;
+  cout << "   --profile-opcodes  runs program, printing the count and time" << endl;
+  cout << "            of each opcode and the most frequent opcode sequences" << endl;
+  cout << "   --sample[=file]  runs program, sampling its call stack every" << endl;
+  cout << "            millisecond and printing the folded stacks (to file)" << endl;
+  cout << "   --profile-lines  runs program, printing the source annotated" << endl;
+  cout << "            with the instruction count and time of each line" << endl;
+  cout << "   --profile-calls[=file]  runs program, printing the calls and" << endl;
+  cout << "            times of each function (and writing callgrind file)" << endl;
+  cout << "   --trace-out=file[,us]  runs program, writing a Chrome trace of" << endl;
+  cout << "            each phase and of the calls lasting at least us (100)" << endl;
+  cout << "   --profile-allocs  runs program, printing the allocations, bytes," << endl;
+  cout << "            and objects live at exit of each allocation site" << endl;
+  cout << "   --heap-stats[=file]  runs program, printing the objects and bytes" << endl;
+  cout << "            of each heap and type (and writing a JSON heap snapshot)" << endl;
   
 
 }
@@ -175,14 +215,15 @@ void printHeaders(string args[]){
 }
 
 /*
-* Input: string flag, istream ptr input
+* Input: string flag, istream ptr input, string file_name
 * Output: void
 * This function takes in the given flag as well as
 * an input stream ptr. Based on the flag, it grabs
 * the right amount of characters from the stream and prints them.
 * If using std input, the function allws user input before printing.
+* The file name (of the input) is only used in profiler reports.
 */
-void printInput(string flag, istream *input){
+void printInput(string flag, istream *input, string file_name){
 
   Lexer lexer = Lexer(*input);
 
@@ -259,6 +300,8 @@ void printInput(string flag, istream *input){
       Program p = parser.parse();
       SemanticChecker t;
       p.accept(t);
+      TreeShaker shaker;
+      p.accept(shaker);
       VM vm;
       CodeGenerator g(vm);
       p.accept(g);
@@ -269,21 +312,412 @@ void printInput(string flag, istream *input){
 
   }
 
-  // if no flag, print all the text
-  if(flag == ""){
+  bool tracing = flag == "--trace" || flag.starts_with("--trace=");
+  bool stepping = flag.starts_with("--step");
+  bool profiling_opcodes = flag == "--profile-opcodes";
+  bool sampling = flag.starts_with("--sample");
+  bool profiling_calls = flag.starts_with("--profile-calls");
+  bool heap_stats = flag.starts_with("--heap-stats");
+  bool profiling_allocs = flag == "--profile-allocs";
+
+  // if no flag (or parallel, trace, step, profile, sample, or heap stats
+  // flag), run the program
+  if(flag == "" || flag == "--parallel" || tracing || stepping ||
+     profiling_opcodes || sampling || profiling_calls || heap_stats ||
+     profiling_allocs){
+
+    VM vm;
+    try {
+      //check and generate function bodies on one thread per core
+      unsigned threads = flag == "--parallel" ? WorkPool::default_size() : 1;
+      {
+        Program p;
+        if(threads > 1){
+          //lex on its own thread, ahead of the parser
+          PipelinedLexer tokens(lexer);
+          p = ASTParser(tokens).parse();
+        }else{
+          p = ASTParser(lexer).parse();
+        }
+        SemanticChecker t(threads);
+        p.accept(t);
+        TreeShaker shaker;
+        p.accept(shaker);
+        CodeGenerator g(vm, false, threads);
+        p.accept(g);
+      }// AST (and its node arena) released before running
+      //the last VM events are printed on an error or on SIGUSR1
+      vm.flight_recorder().watch([&](){
+        if(tracing || stepping){
+          setTraceFilter(flag, vm);
+          vm.run(tracing ? RunMode::TRACE : RunMode::STEP);
+        }else if(profiling_opcodes){
+          OpcodeProfiler profiler;
+          vm.add_profiler(profiler);
+          vm.run();
+          cerr << endl;
+          profiler.print(cerr);
+        }else if(sampling){
+          StackSampler sampler;
+          vm.set_sampler(sampler);
+          sampler.start();
+          vm.run();
+          sampler.stop();
+          writeSamples(flag, sampler);
+        }else if(profiling_calls){
+          CallProfiler profiler;
+          vm.add_profiler(profiler);
+          vm.run();
+          cerr << endl;
+          profiler.print(cerr);
+          size_t eq = flag.find('=');
+          if(eq != string::npos){
+            ofstream out(flag.substr(eq + 1));
+            if(!out){
+              cerr << "ERROR: cannot write " << flag.substr(eq + 1) << endl;
+            }else{
+              profiler.write_callgrind(out, file_name);
+            }
+          }
+        }else if(profiling_allocs){
+          AllocationProfiler profiler;
+          vm.add_profiler(profiler);
+          vm.run();
+          cerr << endl;
+          profiler.print(cerr, vm);
+        }else if(heap_stats){
+          vm.run();
+          printHeapStats(flag, vm);
+        }else{
+          vm.run();
+        }
+      }, cerr);
+    } catch (MyPLException& ex) {
+      cerr << ex.what() << endl;
+    }
+  }
+
+  // if stats, run the program timing each phase
+  if(flag.starts_with("--stats")){
 
     try {
-      ASTParser parser(lexer);
+      runWithStats(flag, input);
+    } catch (MyPLException& ex) {
+      cerr << ex.what() << endl;
+    }
+  }
+
+  // if trace out, run the program writing a trace of each phase
+  if(flag.starts_with("--trace-out=")){
+
+    try {
+      runWithTraceEvents(flag, input);
+    } catch (MyPLException& ex) {
+      cerr << ex.what() << endl;
+    }
+  }
+
+  // if profile lines, run the program counting each line's instructions
+  if(flag == "--profile-lines"){
+
+    try {
+      profileLines(input);
+    } catch (MyPLException& ex) {
+      cerr << ex.what() << endl;
+    }
+  }
+
+  // if lazy, run the program parsing, checking, and generating code for
+  // each function body on first use (the AST is kept for the run)
+  if(flag == "--lazy"){
+
+    try {
+      ASTParser parser(lexer, true);
       Program p = parser.parse();
       SemanticChecker t;
       p.accept(t);
+      TreeShaker shaker;
+      p.accept(shaker);
       VM vm;
-      CodeGenerator g(vm);
+      CodeGenerator g(vm, true);
       p.accept(g);
-      vm.run();
+      vm.flight_recorder().watch([&](){vm.run();}, cerr);
     } catch (MyPLException& ex) {
       cerr << ex.what() << endl;
     }
   }
 
-}
\ No newline at end of file
+}
+/*
+* Input: string flag, VM vm
+* Output: void
+* This function sets the vm's trace filter from the part of a
+* --trace or --step flag after the '=', given as fun, fun:first-last,
+* or :first-last (where either pc may be left out)
+*/
+void setTraceFilter(string flag, VM& vm){
+
+  size_t eq = flag.find('=');
+  if(eq == string::npos){
+    return;
+  }
+  string filter = flag.substr(eq + 1);
+  string fun = filter;
+  int first = 0;
+  int last = -1;
+
+  size_t colon = filter.find(':');
+  if(colon != string::npos){
+
+    fun = filter.substr(0, colon);
+    string range = filter.substr(colon + 1);
+    size_t dash = range.find('-');
+    try{
+      if(dash == string::npos){// a single pc
+        first = last = stoi(range);
+      }else{
+        if(dash > 0){
+          first = stoi(range.substr(0, dash));
+        }
+        if(dash + 1 < range.size()){
+          last = stoi(range.substr(dash + 1));
+        }
+      }
+    }catch(exception& ex){
+      throw MyPLException::VMError("invalid pc range '" + range + "'");
+    }
+  }
+  vm.set_trace_filter(fun, first, last);
+}
+
+/*
+* Input: string flag, istream ptr input
+* Output: void
+* This function runs the program one phase at a time, recording the
+* wall time and allocations of each phase and the execution counts,
+* then prints them to cerr (or as JSON to the file given after the '='
+* of the --stats flag). The source is lexed once on its own to time the
+* lexer; the parse phase includes lexing the source again.
+*/
+void runWithStats(string flag, istream *input){
+
+  RunStats stats;
+  stringstream buffer;
+  buffer << input->rdbuf();
+  string source = buffer.str();
+
+  stats.phase("lex", [&](){
+    stringstream in(source);
+    Lexer lexer(in);
+    while(lexer.next_token().type() != TokenType::EOS);
+  });
+
+  VM vm;
+  {
+    Program p;
+    stats.phase("parse", [&](){
+      stringstream in(source);
+      p = ASTParser(Lexer(in)).parse();
+    });
+    stats.phase("check", [&](){
+      SemanticChecker t;
+      p.accept(t);
+    });
+    stats.phase("tree shake", [&](){
+      TreeShaker shaker;
+      p.accept(shaker);
+    });
+    stats.phase("code generation", [&](){
+      CodeGenerator g(vm);
+      p.accept(g);
+    });
+  }// AST (and its node arena) released before running
+
+  vm.add_profiler(stats.vm);
+  stats.phase("execution", [&](){
+    vm.flight_recorder().watch([&](){vm.run();}, cerr);
+  });
+  stats.vm.measure_heap(vm);
+
+  size_t eq = flag.find('=');
+  if(eq == string::npos){
+    cerr << endl;
+    stats.print(cerr);
+    return;
+  }
+  ofstream out(flag.substr(eq + 1));
+  if(!out){
+    cerr << "ERROR: cannot write " << flag.substr(eq + 1) << endl;
+    return;
+  }
+  stats.print_json(out);
+}
+
+/*
+* Input: string flag, StackSampler sampler
+* Output: void
+* This function writes the sampler's folded stacks to the file given
+* after the '=' of the --sample flag (or to cerr if none)
+*/
+void writeSamples(string flag, const StackSampler& sampler){
+
+  size_t eq = flag.find('=');
+  if(eq == string::npos){
+    cerr << endl;
+    sampler.write_folded(cerr);
+    return;
+  }
+  ofstream out(flag.substr(eq + 1));
+  if(!out){
+    cerr << "ERROR: cannot write " << flag.substr(eq + 1) << endl;
+    return;
+  }
+  sampler.write_folded(out);
+}
+
+/*
+* Input: istream ptr input
+* Output: void
+* This function runs the program with a line profiler, then prints the
+* source to cerr annotated with each line's instruction count and time
+*/
+void profileLines(istream *input){
+
+  stringstream buffer;
+  buffer << input->rdbuf();
+  string source = buffer.str();
+
+  VM vm;
+  {
+    stringstream in(source);
+    Program p = ASTParser(Lexer(in)).parse();
+    SemanticChecker t;
+    p.accept(t);
+    TreeShaker shaker;
+    p.accept(shaker);
+    CodeGenerator g(vm);
+    p.accept(g);
+  }// AST (and its node arena) released before running
+
+  LineProfiler profiler;
+  vm.add_profiler(profiler);
+  vm.flight_recorder().watch([&](){vm.run();}, cerr);
+  cerr << endl;
+  profiler.print(cerr, source);
+}
+
+/*
+* Input: string flag, istream ptr input
+* Output: void
+* This function runs the program adding a span to a Chrome trace for
+* each phase, each function's code generation, and each call lasting
+* at least the given number of microseconds, then writes the trace to
+* the file given by the --trace-out=file[,us] flag. As for --stats,
+* the source is lexed once on its own to time the lexer.
+*/
+void runWithTraceEvents(string flag, istream *input){
+
+  string file = flag.substr(flag.find('=') + 1);
+  double min_duration = 100;
+  size_t comma = file.rfind(',');
+  if(comma != string::npos){
+    try{
+      min_duration = stod(file.substr(comma + 1));
+    }catch(exception& ex){
+      throw MyPLException::VMError("invalid duration '" +
+                                   file.substr(comma + 1) + "'");
+    }
+    file = file.substr(0, comma);
+  }
+
+  TraceEvents events;
+  stringstream buffer;
+  buffer << input->rdbuf();
+  string source = buffer.str();
+
+  // the file is written even if a phase fails
+  auto write = [&](){
+    ofstream out(file);
+    if(!out){
+      cerr << "ERROR: cannot write " << file << endl;
+      return;
+    }
+    events.write(out);
+  };
+
+  try {
+    events.time("Lexer", "frontend", [&](){
+      stringstream in(source);
+      Lexer lexer(in);
+      while(lexer.next_token().type() != TokenType::EOS);
+    });
+
+    VM vm;
+    {
+      Program p;
+      events.time("ASTParser", "frontend", [&](){
+        stringstream in(source);
+        p = ASTParser(Lexer(in)).parse();
+      });
+      events.time("SemanticChecker", "frontend", [&](){
+        SemanticChecker t;
+        p.accept(t);
+      });
+      events.time("TreeShaker", "frontend", [&](){
+        TreeShaker shaker;
+        p.accept(shaker);
+      });
+      events.time("CodeGenerator", "codegen", [&](){
+        CodeGenerator g(vm);
+        g.set_trace(events);
+        p.accept(g);
+      });
+    }// AST (and its node arena) released before running
+
+    TraceProfiler profiler(events, min_duration);
+    vm.add_profiler(profiler);
+    events.time("VM", "vm", [&](){
+      vm.flight_recorder().watch([&](){vm.run();}, cerr);
+    });
+  } catch (MyPLException& ex) {
+    write();
+    throw;
+  }
+  write();
+}
+
+/*
+* Input: string flag, VM vm
+* Output: void
+* This function prints the objects and approximate bytes of each
+* heap and type of a finished run, and writes a heap snapshot to the
+* file given by --heap-stats=file
+*/
+void printHeapStats(string flag, const VM& vm){
+
+  cerr << endl << left << setw(8) << "heap" << setw(20) << "type"
+       << right << setw(10) << "objects" << setw(12) << "bytes" << endl;
+  long objects = 0;
+  long bytes = 0;
+  for(const VMHeapStats& entry : vm.heap_stats()){
+    cerr << left << setw(8) << entry.heap
+         << setw(20) << (entry.type.empty() ? "-" : entry.type)
+         << right << setw(10) << entry.objects << setw(12) << entry.bytes
+         << endl;
+    objects += entry.objects;
+    bytes += entry.bytes;
+  }
+  cerr << left << setw(28) << "total" << right << setw(10) << objects
+       << setw(12) << bytes << endl;
+
+  size_t eq = flag.find('=');
+  if(eq != string::npos){
+    ofstream out(flag.substr(eq + 1));
+    if(!out){
+      cerr << "ERROR: cannot write " << flag.substr(eq + 1) << endl;
+    }else{
+      vm.write_heap_snapshot(out);
+    }
+  }
+
+}
@@ -22,6 +22,16 @@ enum class OpCode {
   MUL,          // pop x and y off stack, push (y * x) onto stack
   DIV,          // pop x and y off stack, push (y / x) onto stack
 
+  // typed arithmetic ops (x and y statically known to be ints/doubles)
+  ADD_INT,      // pop ints x and y, push (y + x)
+  SUB_INT,      // pop ints x and y, push (y - x)
+  MUL_INT,      // pop ints x and y, push (y * x)
+  DIV_INT,      // pop ints x and y, push (y / x)
+  ADD_DBL,      // pop doubles x and y, push (y + x)
+  SUB_DBL,      // pop doubles x and y, push (y - x)
+  MUL_DBL,      // pop doubles x and y, push (y * x)
+  DIV_DBL,      // pop doubles x and y, push (y / x)
+
   // logical operators
   AND,          // pop bools x and y, push (y and x)
   OR,           // pop bools x and y, push (y or x)
@@ -35,6 +45,16 @@ enum class OpCode {
   CMPEQ,        // pop x and y off stack, push (y == x)  
   CMPNE,        // pop x and y off stack, push (y != x)
 
+  // typed comparators (x and y statically known to be ints/doubles)
+  CMPLT_INT,    // pop ints x and y, push (y < x)
+  CMPLE_INT,    // pop ints x and y, push (y <= x)
+  CMPGT_INT,    // pop ints x and y, push (y > x)
+  CMPGE_INT,    // pop ints x and y, push (y >= x)
+  CMPLT_DBL,    // pop doubles x and y, push (y < x)
+  CMPLE_DBL,    // pop doubles x and y, push (y <= x)
+  CMPGT_DBL,    // pop doubles x and y, push (y > x)
+  CMPGE_DBL,    // pop doubles x and y, push (y >= x)
+
   // jump
   JMP,          // [operand] jump to given instruction v
   JMPF,         // [operand] pop x, if x is false jump to instruction v
@@ -55,12 +75,14 @@ enum class OpCode {
   CONCAT,       // pop x, pop y, push y + x (string concat)
     
   // heap
-  ALLOCS,       // allocate struct obj, push oid x
+  ALLOCS,       // [operand] allocate struct obj (of type v), push oid x
   ALLOCA,       // pop x, pop y, allocate array obj with y x values, push oid
-  ALLOCC,       // allocate class obj, push oid x
+  ALLOCC,       // [operand] allocate class obj (of type v), push oid x
   ADDF,         // [operand] pop x, add field named v to obj(x)
   SETF,         // [operand] pop x and y, set obj(y).v = x
   GETF,         // [operand] pop x, push value of obj(x).v 
+  SETF_SLOT,    // [operand] pop x and y, set obj(y)'s v-th field to x
+  GETF_SLOT,    // [operand] pop x, push value of obj(x)'s v-th field
   SETI,         // pop x, y, and z, set array obj(z)[y] = x
   GETI,         // pop x and y, push array obj(y)[x] value
   ADDMEM,       // [operand] pop x, add member named v to obj(x)
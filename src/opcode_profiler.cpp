@@ -0,0 +1,144 @@
+//----------------------------------------------------------------------
+// FILE: opcode_profiler.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the per-opcode profiler
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include "opcode_profiler.h"
+
+using namespace std;
+
+
+void OpcodeProfiler::instruction(const VMFrame& frame, const VMInstr& instr)
+{
+  long now = profile_ticks();
+  stop(now);
+  int op = static_cast<int>(instr.opcode());
+  ++counts[op];
+  if (prev >= 0) {
+    ++pairs[prev * OPCODE_COUNT + op];
+    if (prev2 >= 0)
+      ++triples[(prev2 * OPCODE_COUNT + prev) * OPCODE_COUNT + op];
+  }
+  prev2 = prev;
+  prev = op;
+  running = op;
+  start = now;
+}
+
+
+void OpcodeProfiler::call(const VMFrame& caller, const VMFrame& callee)
+{
+  // sequences never span frames
+  prev = prev2 = -1;
+}
+
+
+void OpcodeProfiler::ret(const VMFrame& frame)
+{
+  prev = prev2 = -1;
+}
+
+
+void OpcodeProfiler::end()
+{
+  stop(profile_ticks());
+  prev = prev2 = -1;
+}
+
+
+void OpcodeProfiler::stop(long now)
+{
+  if (running >= 0)
+    tick_totals[running] += now - start;
+  running = -1;
+}
+
+
+long OpcodeProfiler::count(OpCode op) const
+{
+  return counts[static_cast<int>(op)];
+}
+
+
+long OpcodeProfiler::ticks(OpCode op) const
+{
+  return tick_totals[static_cast<int>(op)];
+}
+
+
+vector<pair<vector<OpCode>, long>>
+OpcodeProfiler::top_sequences(int length, int n) const
+{
+  const unordered_map<int, long>& seqs = length == 2 ? pairs : triples;
+  vector<pair<int, long>> sorted(seqs.begin(), seqs.end());
+  n = min(n, (int) sorted.size());
+  partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(),
+               [](auto& x, auto& y) {
+                 return x.second > y.second or
+                   (x.second == y.second and x.first < y.first);
+               });
+  vector<pair<vector<OpCode>, long>> top;
+  for (int i = 0; i < n; ++i) {
+    vector<OpCode> ops(length);
+    int key = sorted[i].first;
+    for (int j = length - 1; j >= 0; --j) {
+      ops[j] = static_cast<OpCode>(key % OPCODE_COUNT);
+      key /= OPCODE_COUNT;
+    }
+    top.push_back({ops, sorted[i].second});
+  }
+  return top;
+}
+
+
+void OpcodeProfiler::print(ostream& out, int top) const
+{
+  long total_count = accumulate(counts.begin(), counts.end(), 0L);
+  long total_ticks = accumulate(tick_totals.begin(), tick_totals.end(), 0L);
+  auto percent = [](long x, long total) {
+    return total ? 100.0 * x / total : 0.0;
+  };
+
+  // opcodes that ran, by time (then count)
+  vector<int> ops;
+  for (int op = 0; op < OPCODE_COUNT; ++op) {
+    if (counts[op])
+      ops.push_back(op);
+  }
+  sort(ops.begin(), ops.end(), [this](int x, int y) {
+    return tick_totals[x] > tick_totals[y] or
+      (tick_totals[x] == tick_totals[y] and counts[x] > counts[y]);
+  });
+
+  string unit = profile_tick_unit();
+  out << left << setw(12) << "opcode" << right << setw(14) << "count"
+      << setw(8) << "%" << setw(16) << unit << setw(8) << "%"
+      << setw(12) << unit + "/op" << endl;
+  out << fixed << setprecision(1);
+  for (int op : ops) {
+    out << left << setw(12) << to_string(static_cast<OpCode>(op)) << right
+        << setw(14) << counts[op] << setw(8) << percent(counts[op], total_count)
+        << setw(16) << tick_totals[op]
+        << setw(8) << percent(tick_totals[op], total_ticks)
+        << setw(12) << (double) tick_totals[op] / counts[op] << endl;
+  }
+  out << left << setw(12) << "total" << right << setw(14) << total_count
+      << setw(8) << "" << setw(16) << total_ticks << endl;
+
+  for (int length : {2, 3}) {
+    out << endl << "top opcode " << (length == 2 ? "pairs" : "triples")
+        << ":" << endl;
+    for (auto& [seq, n] : top_sequences(length, top)) {
+      string names;
+      for (OpCode op : seq)
+        names += (names.empty() ? "" : " ") + to_string(op);
+      out << "  " << left << setw(36) << names << right << setw(14) << n
+          << setw(8) << percent(n, total_count) << endl;
+    }
+  }
+}
@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------
+// FILE: opcode_profiler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Per-opcode execution counts and times of a VM run
+//----------------------------------------------------------------------
+
+#ifndef OPCODE_PROFILER_H
+#define OPCODE_PROFILER_H
+
+#include <array>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm_profiler.h"
+
+
+// Counts how often each opcode runs and how long it takes (in
+// profile_ticks), where an instruction's time lasts until the next
+// instruction starts (so a CALL or RET includes the frame switch). It
+// also counts the opcode pairs and triples run in sequence within a
+// frame, i.e., the candidates for superinstructions.
+
+class OpcodeProfiler : public VMProfiler
+{
+public:
+
+  void instruction(const VMFrame& frame, const VMInstr& instr) override;
+  void call(const VMFrame& caller, const VMFrame& callee) override;
+  void ret(const VMFrame& frame) override;
+  void end() override;
+
+  // the number of times the opcode ran and its total time
+  long count(OpCode op) const;
+  long ticks(OpCode op) const;
+
+  // the n most frequent opcode sequences of the given length (2 or 3)
+  // with their counts, most frequent first
+  std::vector<std::pair<std::vector<OpCode>, long>>
+  top_sequences(int length, int n) const;
+
+  // print the opcodes sorted by time followed by the top sequences
+  void print(std::ostream& out, int top = 10) const;
+
+private:
+
+  static constexpr int OPCODE_COUNT = static_cast<int>(OpCode::NOP) + 1;
+
+  std::array<long, OPCODE_COUNT> counts {};
+  std::array<long, OPCODE_COUNT> tick_totals {};
+
+  // sequence counts keyed by their opcodes (first in the highest digit
+  // in base OPCODE_COUNT)
+  std::unordered_map<int, long> pairs;
+  std::unordered_map<int, long> triples;
+
+  // the last two opcodes run in the current frame (-1 if none)
+  int prev = -1;
+  int prev2 = -1;
+
+  // the running opcode (-1 if none) and when it started
+  int running = -1;
+  long start = 0;
+
+  // stop timing the running opcode
+  void stop(long now);
+
+};
+
+
+#endif
@@ -0,0 +1,96 @@
+//----------------------------------------------------------------------
+// FILE: pipelined_lexer.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the pipelined lexer and its token ring
+//----------------------------------------------------------------------
+
+#include "pipelined_lexer.h"
+
+using namespace std;
+
+
+TokenRing::TokenRing(size_t capacity)
+{
+  // slots are indexed by position & mask
+  size_t size = 1;
+  while (size < capacity)
+    size *= 2;
+  slots.resize(size);
+  mask = size - 1;
+}
+
+
+bool TokenRing::try_push(Token& token)
+{
+  size_t t = tail.load(memory_order_relaxed);
+  if (t - head.load(memory_order_acquire) == slots.size())
+    return false;
+  slots[t & mask] = std::move(token);
+  tail.store(t + 1, memory_order_release);
+  return true;
+}
+
+
+bool TokenRing::try_pop(Token& token)
+{
+  size_t h = head.load(memory_order_relaxed);
+  if (h == tail.load(memory_order_acquire))
+    return false;
+  token = std::move(slots[h & mask]);
+  head.store(h + 1, memory_order_release);
+  return true;
+}
+
+
+PipelinedLexer::PipelinedLexer(const Lexer& a_lexer, size_t capacity)
+  : lexer {a_lexer}, ring {capacity}
+{
+  producer = thread(&PipelinedLexer::run, this);
+}
+
+
+PipelinedLexer::~PipelinedLexer()
+{
+  stopped = true;
+  producer.join();
+}
+
+
+void PipelinedLexer::run()
+{
+  bool at_end = false;
+  while (!at_end) {
+    Token t;
+    try {
+      t = lexer.next_token();
+    } catch (...) {
+      // end the stream here, reporting the error when it is reached
+      error = current_exception();
+      t = Token(TokenType::EOS, "end-of-stream", 0, 0);
+    }
+    at_end = t.type() == TokenType::EOS;
+    while (!ring.try_push(t)) {
+      if (stopped)
+        return;
+      this_thread::yield();
+    }
+  }
+}
+
+
+Token PipelinedLexer::next_token()
+{
+  if (done)
+    return last;
+  Token t;
+  while (!ring.try_pop(t))
+    this_thread::yield();
+  if (t.type() == TokenType::EOS) {
+    if (error)
+      rethrow_exception(error);
+    done = true;
+    last = t;
+  }
+  return t;
+}
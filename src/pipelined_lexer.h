@@ -0,0 +1,92 @@
+//----------------------------------------------------------------------
+// FILE: pipelined_lexer.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Lexer that runs ahead of the parser on its own thread
+//----------------------------------------------------------------------
+
+#ifndef PIPELINED_LEXER_H
+#define PIPELINED_LEXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+#include "token.h"
+
+
+// Lock-free, fixed-capacity ring buffer of tokens for exactly one
+// producer thread and one consumer thread.
+
+class TokenRing
+{
+public:
+
+  // create a ring holding up to capacity tokens (rounded up to a power
+  // of 2)
+  TokenRing(std::size_t capacity);
+
+  // move the token into the ring (false if the ring is full)
+  bool try_push(Token& token);
+
+  // move the oldest token out of the ring (false if the ring is empty)
+  bool try_pop(Token& token);
+
+private:
+
+  std::vector<Token> slots;
+  std::size_t mask;
+
+  // next slot to pop (written by the consumer only) and next slot to
+  // push (written by the producer only), kept on separate cache lines
+  alignas(64) std::atomic<std::size_t> head {0};
+  alignas(64) std::atomic<std::size_t> tail {0};
+
+};
+
+
+// Runs the given lexer on a separate thread, buffering its tokens in a
+// TokenRing. A lexer error is rethrown by next_token when the parser
+// reaches the point in the token stream where it occurred.
+
+class PipelinedLexer
+{
+public:
+
+  // start lexing (the lexer's input stream must outlive this object)
+  PipelinedLexer(const Lexer& lexer, std::size_t capacity = 4096);
+
+  // stop the lexer thread (if still running)
+  ~PipelinedLexer();
+
+  PipelinedLexer(const PipelinedLexer&) = delete;
+  PipelinedLexer& operator=(const PipelinedLexer&) = delete;
+
+  // Return the next token (EOS once the input is exhausted)
+  Token next_token();
+
+private:
+
+  Lexer lexer;
+  TokenRing ring;
+  std::thread producer;
+
+  // set by the consumer to make a blocked producer give up
+  std::atomic<bool> stopped {false};
+
+  // error raised by the lexer (published by the EOS pushed after it)
+  std::exception_ptr error;
+
+  // the EOS token, once consumed
+  bool done = false;
+  Token last;
+
+  // producer thread loop
+  void run();
+
+};
+
+
+#endif
@@ -7,6 +7,7 @@
 //----------------------------------------------------------------------
 
 #include "print_visitor.h"
+#include "ast_parser.h"
 #include <iostream>
 
 using namespace std;
@@ -39,18 +40,20 @@ void PrintVisitor::print_indent()
 void PrintVisitor::visit(Program& p)
 {
   inc_indent();//increment indent amount once
+  arena = &p.arena;
 
-  for (auto struct_def : p.struct_defs)
+  for (auto& struct_def : p.struct_defs)
     struct_def.accept(*this);
-  for (auto class_def : p.class_defs)
+  for (auto& class_def : p.class_defs)
     class_def.accept(*this);
-  for (auto fun_def : p.fun_defs)
+  for (auto& fun_def : p.fun_defs)
     fun_def.accept(*this);
 }
 
 
 void PrintVisitor::visit(FunDef& f)
-{ cout << "\n";
+{ ASTParser::parse_body(*arena, f);
+  cout << "\n";
   //print return type and func name
   cout << f.return_type.type_name << " ";
   cout << f.fun_name.lexeme() << "(";
@@ -69,7 +72,7 @@ void PrintVisitor::visit(FunDef& f)
   //print stmts in func body
   for(auto stmt : f.stmts){
     print_indent();
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
     cout << "\n";
   }
 
@@ -115,7 +118,7 @@ void PrintVisitor::visit(ClassDef& c)
     cout << m.data_type.type_name << " " << m.var_name.lexeme() << endl;
   }
   //print all private methods
-  for(auto m: c.private_methods){
+  for(auto &m: c.private_methods){
     print_indent();
     m.accept(*this);
   }
@@ -128,7 +131,7 @@ void PrintVisitor::visit(ClassDef& c)
     cout << m.data_type.type_name << " " << m.var_name.lexeme() << endl;
 
   }
-  for(auto m: c.public_methods){
+  for(auto &m: c.public_methods){
     print_indent();
     m.accept(*this);
   }
@@ -156,7 +159,7 @@ void PrintVisitor::visit(WhileStmt& s)
   inc_indent();
   for(auto stmt : s.stmts){
     print_indent();
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
     cout << "\n";
   }
   dec_indent();
@@ -186,7 +189,7 @@ void PrintVisitor::visit(ForStmt& s)
   for(auto stmt : s.stmts){
     print_indent();
     //call stmt to print itself
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
   }
   cout << "\n";
   dec_indent();
@@ -206,7 +209,7 @@ void PrintVisitor::visit(IfStmt& s)
   //print stmts
   for(auto stmt : s.if_part.stmts){
     print_indent();
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
     cout << "\n";
   }
   dec_indent();
@@ -218,7 +221,7 @@ void PrintVisitor::visit(IfStmt& s)
   }
  
   if(s.else_ifs.size() > 0){//check if else ifs are not empty
-    for(auto else_if : s.else_ifs){
+    for(auto &else_if : s.else_ifs){
       print_indent();
       cout << "elseif (";
       //print condition
@@ -229,7 +232,7 @@ void PrintVisitor::visit(IfStmt& s)
       //print stmts
       for(auto stmt : else_if.stmts){
         print_indent();
-        stmt->accept(*this);
+        arena->accept(stmt, *this);
         cout << "\n";
       }
       dec_indent();
@@ -251,7 +254,7 @@ void PrintVisitor::visit(IfStmt& s)
     //go through else stmts
     for(auto else_stmt : s.else_stmts){
       print_indent();
-      else_stmt->accept(*this);
+      arena->accept(else_stmt, *this);
       cout << "\n";
 
     }
@@ -325,29 +328,30 @@ void PrintVisitor::visit(CallExpr& e)
 
 void PrintVisitor::visit(Expr& e)
 {  
-  //if negated print 'not'
-  if(e.negated){
-    cout << "not (";
+  span<ExprPart> parts = arena->parts(e);
+  // if no terms, print 'null'
+  if(parts.empty()){
+    cout << "null";
+    return;
   }
 
-  //visit expr term
-  if(e.first != nullptr){
-
-    //visit first expr term
-    e.first->accept(*this);
+  int negations = 0;
+  for(auto& part : parts){
+    //if negated print 'not' (closed at the end of the expression)
+    if(part.negated){
+      cout << "not (";
+      negations++;
+    }
+    //visit expr term
+    arena->accept(part.term, *this);
 
     //if op has val print op
-    if(e.op.has_value()){
-      cout << " " <<  e.op.value().lexeme() << " ";
-      //print last expr
-      e.rest->accept(*this);
+    if(part.op.has_value()){
+      cout << " " <<  part.op.value().lexeme() << " ";
     }
-  }else{// if nullptr, print 'null'
-    cout << "null";
-    
   }
-  //if negated, add right paren
-  if(e.negated){
+  //add a right paren for each negated part
+  for(int i = 0; i < negations; i++){
     cout << ")";
   }
 }
@@ -355,7 +359,7 @@ void PrintVisitor::visit(Expr& e)
 void PrintVisitor::visit(SimpleTerm& t)
 { 
   //visit rvalue
-  t.rvalue->accept(*this);
+  arena->accept(t.rvalue, *this);
   
 }
 
@@ -36,6 +36,7 @@ public:
   
 private:
   std::ostream& out;  
+  ASTArena* arena = nullptr;
   int indent = 0;
   const int INDENT_AMT = 2;
 
@@ -0,0 +1,157 @@
+//----------------------------------------------------------------------
+// FILE: run_stats.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the run statistics (and of the counting
+// operator new they rely on)
+//----------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include "run_stats.h"
+#include "vm.h"
+
+using namespace std;
+
+
+//----------------------------------------------------------------------
+// Allocation counting
+//----------------------------------------------------------------------
+
+namespace {
+  atomic<bool> counting {false};
+  atomic<long> alloc_count {0};
+  atomic<long> alloc_bytes {0};
+}
+
+void* operator new(size_t size)
+{
+  // a single load unless --stats is counting
+  if (counting.load(memory_order_relaxed)) {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add(size, memory_order_relaxed);
+  }
+  if (void* p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t size) noexcept
+{
+  free(p);
+}
+
+long allocation_count()
+{
+  return alloc_count.load(memory_order_relaxed);
+}
+
+long allocation_bytes()
+{
+  return alloc_bytes.load(memory_order_relaxed);
+}
+
+void set_allocation_counting(bool on)
+{
+  counting.store(on, memory_order_relaxed);
+}
+
+
+//----------------------------------------------------------------------
+// VM counts
+//----------------------------------------------------------------------
+
+void VMStats::instruction(const VMFrame& frame, const VMInstr& instr)
+{
+  ++instructions;
+  OpCode op = instr.opcode();
+  if (op == OpCode::ALLOCS)
+    ++struct_objects;
+  else if (op == OpCode::ALLOCA)
+    ++array_objects;
+  else if (op == OpCode::ALLOCC)
+    ++class_objects;
+}
+
+void VMStats::call(const VMFrame& caller, const VMFrame& callee)
+{
+  ++calls;
+  ++call_depth;
+  if (call_depth > max_call_depth)
+    max_call_depth = call_depth;
+}
+
+void VMStats::ret(const VMFrame& frame)
+{
+  --call_depth;
+}
+
+long VMStats::peak_heap_objects() const
+{
+  return struct_objects + array_objects + class_objects;
+}
+
+void VMStats::measure_heap(const VM& vm)
+{
+  peak_heap_bytes = 0;
+  for (const VMHeapStats& entry : vm.heap_stats())
+    peak_heap_bytes += entry.bytes;
+}
+
+
+//----------------------------------------------------------------------
+// Reports
+//----------------------------------------------------------------------
+
+void RunStats::print(ostream& out) const
+{
+  out << left << setw(18) << "phase" << right << setw(12) << "time (s)"
+      << setw(14) << "allocations" << setw(16) << "bytes" << endl;
+  double total = 0;
+  for (const Phase& p : phases) {
+    out << left << setw(18) << p.name << right << setw(12) << fixed
+        << setprecision(6) << p.seconds << setw(14) << p.allocations
+        << setw(16) << p.allocated_bytes << endl;
+    total += p.seconds;
+  }
+  out << left << setw(18) << "total" << right << setw(12) << total << endl;
+  out << endl;
+  out << "instructions executed: " << vm.instructions << endl;
+  out << "calls made...........: " << vm.calls << endl;
+  out << "max call depth.......: " << vm.max_call_depth << endl;
+  out << "struct objects.......: " << vm.struct_objects << endl;
+  out << "array objects........: " << vm.array_objects << endl;
+  out << "class objects........: " << vm.class_objects << endl;
+  out << "peak heap objects....: " << vm.peak_heap_objects() << endl;
+  out << "peak heap bytes (est): " << vm.peak_heap_bytes << endl;
+}
+
+void RunStats::print_json(ostream& out) const
+{
+  out << "{\n  \"phases\": [";
+  for (int i = 0; i < phases.size(); ++i) {
+    const Phase& p = phases[i];
+    // phase names are plain identifiers (nothing to escape)
+    out << (i ? "," : "") << "\n    {\"name\": \"" << p.name
+        << "\", \"seconds\": " << fixed << setprecision(6) << p.seconds
+        << ", \"allocations\": " << p.allocations
+        << ", \"allocated_bytes\": " << p.allocated_bytes << "}";
+  }
+  out << "\n  ],\n  \"execution\": {"
+      << "\n    \"instructions\": " << vm.instructions << ","
+      << "\n    \"calls\": " << vm.calls << ","
+      << "\n    \"max_call_depth\": " << vm.max_call_depth << ","
+      << "\n    \"objects\": {\"struct\": " << vm.struct_objects
+      << ", \"array\": " << vm.array_objects
+      << ", \"class\": " << vm.class_objects << "},"
+      << "\n    \"peak_heap_objects\": " << vm.peak_heap_objects() << ","
+      << "\n    \"peak_heap_bytes\": " << vm.peak_heap_bytes
+      << "\n  }\n}" << endl;
+}
@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------
+// FILE: run_stats.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Phase timing and execution statistics of a mypl run
+//----------------------------------------------------------------------
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "vm_profiler.h"
+
+class VM;
+
+
+// the number and total size of the memory allocations (calls to
+// operator new) counted so far by the process, where allocations are
+// only counted while counting is on (off by default, and turned on by
+// RunStats::phase while a phase runs)
+long allocation_count();
+long allocation_bytes();
+void set_allocation_counting(bool on);
+
+
+// Counts the instructions, calls, and heap objects of a VM run (as a
+// profiler of the run).
+
+class VMStats : public VMProfiler
+{
+public:
+
+  void instruction(const VMFrame& frame, const VMInstr& instr) override;
+  void call(const VMFrame& caller, const VMFrame& callee) override;
+  void ret(const VMFrame& frame) override;
+
+  long instructions = 0;
+  long calls = 0;
+
+  // deepest call stack (main alone is depth 1)
+  int max_call_depth = 1;
+
+  // objects allocated in each heap
+  long struct_objects = 0;
+  long array_objects = 0;
+  long class_objects = 0;
+
+  // objects are never freed, so the heaps peak at the end of the run:
+  // the number of heap objects, and their approximate total size (as
+  // for VM::heap_stats) once set by measure_heap after the run
+  long peak_heap_objects() const;
+  long peak_heap_bytes = 0;
+  void measure_heap(const VM& vm);
+
+private:
+
+  int call_depth = 1;
+
+};
+
+
+// The wall time and allocations of each phase of a run plus the
+// execution counts, reported as a table or as JSON.
+
+class RunStats
+{
+public:
+
+  class Phase
+  {
+  public:
+    std::string name;
+    double seconds;
+    long allocations;
+    long allocated_bytes;
+  };
+
+  // the phases in the order they were run
+  std::vector<Phase> phases;
+
+  // the execution counts (to add as a profiler of the run)
+  VMStats vm;
+
+  // run f as the named phase
+  template<typename F> void phase(const std::string& name, F f);
+
+  // print the stats as a table or as a JSON object
+  void print(std::ostream& out) const;
+  void print_json(std::ostream& out) const;
+
+};
+
+
+template<typename F>
+void RunStats::phase(const std::string& name, F f)
+{
+  long count = allocation_count();
+  long bytes = allocation_bytes();
+  set_allocation_counting(true);
+  auto start = std::chrono::steady_clock::now();
+  try {
+    f();
+  } catch (...) {
+    set_allocation_counting(false);
+    throw;
+  }
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  set_allocation_counting(false);
+  phases.push_back({name, time.count(), allocation_count() - count,
+                    allocation_bytes() - bytes});
+}
+
+
+#endif
@@ -8,6 +8,8 @@
 #include <unordered_set>
 #include "mypl_exception.h"
 #include "semantic_checker.h"
+#include "ast_parser.h"
+#include "work_pool.h"
 #include <iostream>
 
 
@@ -18,52 +20,13 @@ const unordered_set<string> BASE_TYPES {"int", "double", "char", "string", "bool
 const unordered_set<string> BUILT_INS {"print", "input", "to_string",  "to_int",
   "to_double", "length", "get", "concat"};
 
+// symbol table name used for the enclosing function's return type
+const SymbolId RETURN_SYMBOL = Symbols::intern("return");
 
-// helper functions
 
-optional<VarDef> SemanticChecker::get_field(const StructDef& struct_def,
-                                            const string& field_name)
+SemanticChecker::SemanticChecker(unsigned thread_count)
+  : thread_count(thread_count)
 {
-  for (const VarDef& var_def : struct_def.fields)
-    if (var_def.var_name.lexeme() == field_name)
-      return var_def;
-  return nullopt;
-}
-
-optional<VarDef> SemanticChecker::get_member(const ClassDef& class_def, const string& member_name, const string& vis){
-
-  if(vis == "public"){
-    for(const VarDef& v : class_def.public_members){
-      if(v.var_name.lexeme() == member_name){
-        return v;
-      }
-    }
-  }else{
-    for(const VarDef& v : class_def.private_members){
-      if(v.var_name.lexeme() == member_name){
-        return v;
-      }
-    }
-  }
-  return nullopt;
-}
-
-optional<FunDef> SemanticChecker::get_method(const ClassDef& class_def, const std::string& method_name, const std::string& vis){
-
-  if(vis == "public"){
-    for(const FunDef& f : class_def.public_methods){
-      if(f.fun_name.lexeme() == method_name){
-        return f;
-      }
-    }
-  }else{
-    for(const FunDef& f : class_def.private_methods){
-      if(f.fun_name.lexeme() == method_name){
-        return f;
-      }
-    }
-  }
-  return nullopt;
 }
 
 
@@ -86,14 +49,15 @@ void SemanticChecker::error(const string& msg)
 
 void SemanticChecker::visit(Program& p)
 {
-  // record each struct def
+  arena = &p.arena;
+  defs = &p.defs;
+  // check for duplicate struct defs (the index keeps the first one)
   for (StructDef& d : p.struct_defs) {
     string name = d.struct_name.lexeme();
-    if (struct_defs.count(name))
+    if (defs->get_struct(name) != &d)
       error("multiple definitions of '" + name + "'", d.struct_name);
-    struct_defs[name] = d;
   }
-  // record each function def (need a main function)
+  // check each function def (need a main function)
   bool found_main = false;
   for (FunDef& f : p.fun_defs) {
     string name = f.fun_name.lexeme();
@@ -108,29 +72,73 @@ void SemanticChecker::visit(Program& p)
         error("main function cannot have parameters", f.params[0].var_name);
       found_main = true;
     }
-    fun_defs[name] = f;
   }
   if (!found_main)
     error("program missing main function");
 
-  //record each class def
+  //check for duplicate class defs
   for(ClassDef& c : p.class_defs){
     string name = c.class_name.lexeme();
-    if(class_defs.count(name))
+    if(defs->get_class(name) != &c)
       error("multiple definitions of '" + name + "'", c.class_name);
-    class_defs[name] = c;
   }
 
   // check each struct
   for (StructDef& d : p.struct_defs)
     d.accept(*this);
-  // check each function
-  for (FunDef& d : p.fun_defs)
-    d.accept(*this);
+  // check each function (bodies are independent once the definitions
+  // are indexed, so fully parsed ones can be checked in parallel)
+  if (thread_count > 1 && arena->body_tokens.empty())
+    check_parallel(p.fun_defs);
+  else {
+    for (FunDef& d : p.fun_defs)
+      d.accept(*this);
+  }
   //check eah class
   for (ClassDef& c: p.class_defs)
     c.accept(*this);
 
+  // parse and check the pre-parsed bodies reachable from main
+  request_body("main");
+  while (!pending_bodies.empty()) {
+    FunDef& f = *pending_bodies.back();
+    pending_bodies.pop_back();
+    if (!f.lazy_body())
+      continue;
+    ASTParser::parse_body(*arena, f);
+    f.accept(*this);
+  }
+}
+
+
+void SemanticChecker::check_parallel(vector<FunDef>& fun_defs)
+{
+  // one checker (and symbol table) per worker thread
+  vector<SemanticChecker> workers(thread_count);
+  for (SemanticChecker& w : workers) {
+    w.arena = arena;
+    w.defs = defs;
+  }
+  auto errors = WorkPool::run(fun_defs.size(), thread_count,
+                              [&](unsigned worker, size_t i) {
+    try {
+      fun_defs[i].accept(workers[worker]);
+    } catch (MyPLException& ex) {
+      // drop the environments left open by the error
+      workers[worker].symbol_table = SymbolTable();
+      throw;
+    }
+  });
+  // report the error of the first function in source order
+  WorkPool::rethrow_first(errors);
+}
+
+
+void SemanticChecker::request_body(const string& fun_name)
+{
+  FunDef* f = defs->get_function(fun_name);
+  if (f && f->lazy_body())
+    pending_bodies.push_back(f);
 }
 
 
@@ -157,17 +165,15 @@ void SemanticChecker::visit(FunDef& f)
   //save return type
   DataType return_type = f.return_type;
   //add return type to symbol table
-  symbol_table.add("return", return_type);
+  symbol_table.add(RETURN_SYMBOL, return_type);
+  frame_base = symbol_table.size();
 
   //check for undefined struct return type
   if(!BASE_TYPES.count(return_type.type_name) && return_type.type_name != "void"){
-    if(!struct_defs.count(return_type.type_name)){
+    if(!defs->get_struct(return_type.type_name)){
       error("Undefined function return type", f.fun_name);
     }
   }
-  //add fun name to fun_defs
-  fun_defs[f.fun_name.lexeme()] = f;
-
   //make table for param names
   unordered_set<string> param_names;
 
@@ -186,7 +192,7 @@ void SemanticChecker::visit(FunDef& f)
     param_names.insert(p.var_name.lexeme());
 
     //if param is a struct type, check existing struct defs
-    if(!BASE_TYPES.count(p.data_type.type_name) && !struct_defs.count(p.data_type.type_name) && !class_defs.count(p.data_type.type_name)){
+    if(!BASE_TYPES.count(p.data_type.type_name) && !defs->get_struct(p.data_type.type_name) && !defs->get_class(p.data_type.type_name)){
       error("Undefined type param", p.first_token());
       
     }
@@ -198,12 +204,18 @@ void SemanticChecker::visit(FunDef& f)
     }
 
     //add to symbol table
-    symbol_table.add(p.var_name.lexeme(), curr_type);
+    symbol_table.add(p.var_name.symbol(), curr_type);
+  }
+
+  //pre-parsed body is checked once requested (see visit(Program))
+  if(f.lazy_body()){
+    symbol_table.pop_environment();
+    return;
   }
 
   //check each stmt
   for(auto &s : f.stmts){
-    s->accept(*this);
+    arena->accept(s, *this);
   }
 
   //pop environment
@@ -216,9 +228,6 @@ void SemanticChecker::visit(StructDef& s)
   //push new environment
   symbol_table.push_environment();
 
-  //add struct name to struct_defs
-  struct_defs[s.struct_name.lexeme()] = s;
-
   //create unordered set for fields
   unordered_set<string> fields;
 
@@ -236,7 +245,7 @@ void SemanticChecker::visit(StructDef& s)
     fields.insert(f.var_name.lexeme());
 
     //if field is a struct type, check existing struct defs
-    if(!BASE_TYPES.count(f.data_type.type_name) && !struct_defs.count(f.data_type.type_name)){
+    if(!BASE_TYPES.count(f.data_type.type_name) && !defs->get_struct(f.data_type.type_name)){
       error("Undefined type", f.first_token());
     
     }
@@ -254,11 +263,8 @@ void SemanticChecker::visit(ClassDef& c){
   unordered_set<string> members;
   unordered_set<string> methods;
 
-  //add class name to class defs
-  class_defs[c.class_name.lexeme()] = c;
-
   //go through private members
-  for(auto m : c.private_members){
+  for(auto &m : c.private_members){
     if(members.count(m.var_name.lexeme())){
       error("Multiple definitions of data member", m.var_name);
     }
@@ -269,15 +275,15 @@ void SemanticChecker::visit(ClassDef& c){
 
     //check if field is struct/class type
     if(!BASE_TYPES.count(m.data_type.type_name)){
-      if(!struct_defs.count(m.data_type.type_name)){
-        if(!class_defs.count(m.data_type.type_name)){
+      if(!defs->get_struct(m.data_type.type_name)){
+        if(!defs->get_class(m.data_type.type_name)){
           error("undefined type member", m.first_token());
         }
       }
     }
   }
   //go through public members
-  for(auto m : c.public_members){
+  for(auto &m : c.public_members){
     if(members.count(m.var_name.lexeme())){
       error("Multiple definitions of data member", m.first_token());
     }
@@ -288,8 +294,8 @@ void SemanticChecker::visit(ClassDef& c){
 
     //check if field is struct/class type
     if(!BASE_TYPES.count(m.data_type.type_name)){
-      if(!struct_defs.count(m.data_type.type_name)){
-        if(!class_defs.count(m.data_type.type_name)){
+      if(!defs->get_struct(m.data_type.type_name)){
+        if(!defs->get_class(m.data_type.type_name)){
           error("undefined type member", m.first_token());
         }
       }
@@ -324,19 +330,19 @@ void SemanticChecker::visit(ClassDef& c){
 void SemanticChecker::visit(ReturnStmt& s)
 {
   //get return type from symbol table
-  DataType return_type = symbol_table.get("return").value();
+  DataType return_type = *symbol_table.get(RETURN_SYMBOL);
 
   //type check return expr
   s.expr.accept(*this);
 
   //compare return type against curr type
   if(curr_type.type_name != return_type.type_name && curr_type.type_name != "void"){
-    error("Incompatible function return type", s.expr.first_token());
+    error("Incompatible function return type", arena->first_token(s.expr));
     
   } 
   //compare array type
   if(curr_type.is_array != return_type.is_array){
-    error("Incompatible array function return type", s.expr.first_token());
+    error("Incompatible array function return type", arena->first_token(s.expr));
   }
 }
 
@@ -350,15 +356,15 @@ void SemanticChecker::visit(WhileStmt& s)
   s.condition.accept(*this);
 
   if(curr_type.type_name != "bool"){
-    error("while stmt condition not bool type", s.condition.first_token());
+    error("while stmt condition not bool type", arena->first_token(s.condition));
 
   }
   if(curr_type.is_array){
-    error("while stmt condition is an array", s.condition.first_token());
+    error("while stmt condition is an array", arena->first_token(s.condition));
   }
   //check stmts
   for(auto stmt : s.stmts){
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
   }
   //pop env
   symbol_table.pop_environment();
@@ -373,27 +379,27 @@ void SemanticChecker::visit(ForStmt& s)
   //check that vardecl stmt is type int
   s.var_decl.accept(*this);
   if(curr_type.type_name != "int" && curr_type.type_name != "void"){
-    error("non integer in for stmt var decl", s.assign_stmt.expr.first_token());
+    error("non integer in for stmt var decl", arena->first_token(s.assign_stmt.expr));
   }
 
   //check that condition is bool and is not array
   s.condition.accept(*this);
 
   if(curr_type.type_name != "bool"){
-    error("while stmt condition not bool type", s.condition.first_token());
+    error("while stmt condition not bool type", arena->first_token(s.condition));
 
   }
   if(curr_type.is_array){
-    error("while stmt condition is an array", s.condition.first_token());
+    error("while stmt condition is an array", arena->first_token(s.condition));
   }
   //check that assign stmt var is type int
   s.assign_stmt.accept(*this);
   if(curr_type.type_name != "int"){
-    error("non integer in for loop assign stmt", s.assign_stmt.expr.first_token());
+    error("non integer in for loop assign stmt", arena->first_token(s.assign_stmt.expr));
   }
   //check stmts
   for(auto stmt : s.stmts){
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
   }
   //pop env
   symbol_table.pop_environment();
@@ -406,24 +412,24 @@ void SemanticChecker::visit(IfStmt& s)
   s.if_part.condition.accept(*this);
 
   if(curr_type.type_name != "bool"){
-    error("if stmt condition not bool type", s.if_part.condition.first_token());
+    error("if stmt condition not bool type", arena->first_token(s.if_part.condition));
 
   }
   if(curr_type.is_array){
-    error("if stmt condition is an array", s.if_part.condition.first_token());
+    error("if stmt condition is an array", arena->first_token(s.if_part.condition));
   }
   //push new env
   symbol_table.push_environment();
 
   //for each stmt, type check
   for(auto stmt : s.if_part.stmts){
-    stmt->accept(*this);
+    arena->accept(stmt, *this);
   }
   //push new env
   symbol_table.pop_environment();
 
   //if else if part, repeat same steps as for if
-  for(auto elseif : s.else_ifs){
+  for(auto &elseif : s.else_ifs){
 
     symbol_table.push_environment();
 
@@ -431,15 +437,15 @@ void SemanticChecker::visit(IfStmt& s)
     elseif.condition.accept(*this);
 
     if(curr_type.type_name != "bool"){
-      error("if stmt condition not bool type", elseif.condition.first_token());
+      error("if stmt condition not bool type", arena->first_token(elseif.condition));
 
     }
     if(curr_type.is_array){
-      error("if stmt condition is an array", s.if_part.condition.first_token());
+      error("if stmt condition is an array", arena->first_token(s.if_part.condition));
     }
     //for each stmt, type check
     for(auto stmt : elseif.stmts){
-      stmt->accept(*this);
+      arena->accept(stmt, *this);
     }
     symbol_table.pop_environment();
   }
@@ -448,7 +454,7 @@ void SemanticChecker::visit(IfStmt& s)
     symbol_table.push_environment();
     for(auto else_part : s.else_stmts){
     
-      else_part->accept(*this);
+      arena->accept(else_part, *this);
     }
       symbol_table.pop_environment();
   }
@@ -460,14 +466,14 @@ void SemanticChecker::visit(VarDeclStmt& s)
   DataType lhs_type = s.var_def.data_type;
   //check if datatype exists
   if(!BASE_TYPES.count(lhs_type.type_name)){
-    if(!struct_defs.count(lhs_type.type_name)){
-      if(!class_defs.count(lhs_type.type_name)){
+    if(!defs->get_struct(lhs_type.type_name)){
+      if(!defs->get_class(lhs_type.type_name)){
         error("undefined variable type", s.var_def.first_token());
       }
     }
   }
   //check if var name is in curr env
-  if(symbol_table.name_exists_in_curr_env(s.var_def.var_name.lexeme())){
+  if(symbol_table.name_exists_in_curr_env(s.var_def.var_name.symbol())){
     error("Var previously declared in curr env", s.var_def.var_name);
   }
 
@@ -475,9 +481,10 @@ void SemanticChecker::visit(VarDeclStmt& s)
   s.expr.accept(*this);
 
   //check if vardecl expr has op
-  if(s.expr.op.has_value()){
+  const optional<Token>& expr_op = arena->parts(s.expr)[0].op;
+  if(expr_op.has_value()){
 
-    string op_val = s.expr.op.value().lexeme();
+    string op_val = expr_op.value().lexeme();
 
     //check if expr is comparison, equality, or logical op
     if(op_val != "+" && op_val != "-" && op_val != "*" && op_val != "/"){
@@ -500,7 +507,8 @@ void SemanticChecker::visit(VarDeclStmt& s)
 
   }
   //add var to symbol table
-  symbol_table.add(s.var_def.var_name.lexeme(), lhs_type);
+  symbol_table.add(s.var_def.var_name.symbol(), lhs_type);
+  s.slot = symbol_table.index(s.var_def.var_name.symbol()) - frame_base;
 }
 
 
@@ -513,10 +521,13 @@ void SemanticChecker::visit(AssignStmt& s)
 
     if(i == 0){
       //check if var exists
-      if(!symbol_table.name_exists(s.lvalue[i].var_name.lexeme())){
-        error("undefined lhs var in assign stmt", s.expr.first_token());
+      const DataType *var_type = symbol_table.get(s.lvalue[i].var_name.symbol());
+      if(!var_type){
+        error("undefined lhs var in assign stmt", arena->first_token(s.expr));
       }else{
-        lhs_type = symbol_table.get(s.lvalue[i].var_name.lexeme()).value();
+        lhs_type = *var_type;
+        s.lvalue[i].access = AccessKind::VAR;
+        s.lvalue[i].slot = symbol_table.index(s.lvalue[i].var_name.symbol()) - frame_base;
       }
     }
 
@@ -524,39 +535,45 @@ void SemanticChecker::visit(AssignStmt& s)
 
       prev_type = lhs_type;
 
-      if(struct_defs.count(prev_type.type_name)){
-        const StructDef &sd = struct_defs[prev_type.type_name];
+      if(defs->get_struct(prev_type.type_name)){
+        const StructDef &sd = *defs->get_struct(prev_type.type_name);
 
         //check field
-        if(!get_field(sd, s.lvalue[i].var_name.lexeme())){
+        const VarDef *field = defs->get_field(sd, s.lvalue[i].var_name.lexeme());
+        if(!field){
           error("Field does not exist in lvalue in assignstmt", s.lvalue[i].var_name);
 
         }else{
-          lhs_type = get_field(sd, s.lvalue[i].var_name.lexeme()).value().data_type;
+          lhs_type = field->data_type;
+          s.lvalue[i].access = AccessKind::FIELD;
+          s.lvalue[i].slot = field - sd.fields.data();
         }
 
-      }else if(class_defs.count(prev_type.type_name)){
-        const ClassDef &cd = class_defs[prev_type.type_name];
+      }else if(defs->get_class(prev_type.type_name)){
+        const ClassDef &cd = *defs->get_class(prev_type.type_name);
  
         //check public members & methods
         if(!s.lvalue[i].is_method){
-          if(get_member(cd, s.lvalue[i].var_name.lexeme(), "private")){
+          if(defs->get_member(cd, s.lvalue[i].var_name.lexeme(), false)){
             error("member is private", s.lvalue[i].var_name);
 
-          }else if(!get_member(cd, s.lvalue[i].var_name.lexeme(), "public")){
+          }else if(!defs->get_member(cd, s.lvalue[i].var_name.lexeme(), true)){
             error("public member does not exist", s.lvalue[i].var_name);
 
           }else{
-            lhs_type = get_member(cd, s.lvalue[i].var_name.lexeme(), "public").value().data_type;
+            lhs_type = defs->get_member(cd, s.lvalue[i].var_name.lexeme(), true)->data_type;
+            s.lvalue[i].access = AccessKind::MEMBER;
           }
         }else if((s.lvalue[i].is_method)){
-          if(get_method(cd, s.lvalue[i].var_name.lexeme(), "private")){
+          if(defs->get_method(cd, s.lvalue[i].var_name.lexeme(), false)){
             error("method is private", s.lvalue[i].var_name);
 
-          }else if(!get_method(cd, s.lvalue[i].var_name.lexeme(), "public")){
+          }else if(!defs->get_method(cd, s.lvalue[i].var_name.lexeme(), true)){
             error("public method does not exist", s.lvalue[i].var_name);
           }else{
-            lhs_type = get_method(cd, s.lvalue[i].var_name.lexeme(), "public").value().return_type;
+            lhs_type = defs->get_method(cd, s.lvalue[i].var_name.lexeme(), true)->return_type;
+            s.lvalue[i].access = AccessKind::METHOD;
+            request_body(s.lvalue[i].var_name.lexeme());
           }
         }
 
@@ -569,12 +586,12 @@ void SemanticChecker::visit(AssignStmt& s)
 
       //check that var is array
       if(!lhs_type.is_array){
-        error("Non array with array expr in assign stmt", s.expr.first_token());
+        error("Non array with array expr in assign stmt", arena->first_token(s.expr));
       }
       //check index is int
       s.lvalue[i].array_expr.value().accept(*this);
       if(curr_type.type_name != "int"){
-        error("non int type index in array assign stmt", s.expr.first_token());
+        error("non int type index in array assign stmt", arena->first_token(s.expr));
       }
 
       //change is array to false
@@ -586,7 +603,7 @@ void SemanticChecker::visit(AssignStmt& s)
 
   if(lhs_type.type_name != curr_type.type_name) {
     if(curr_type.type_name != "void"){
-      error("Mismatched types in assign stmt", s.expr.first_token());
+      error("Mismatched types in assign stmt", arena->first_token(s.expr));
 
     }else{
       curr_type = {curr_type.is_array, lhs_type.type_name};
@@ -594,7 +611,7 @@ void SemanticChecker::visit(AssignStmt& s)
     }
   }
   if(lhs_type.is_array != curr_type.is_array){
-    error("mismatched array types in assign stmt", s.expr.first_token());
+    error("mismatched array types in assign stmt", arena->first_token(s.expr));
   }
   
 }
@@ -746,11 +763,13 @@ void SemanticChecker::visit(CallExpr& e)
   }else{//user made func
 
     //check that func is in fundefs vector
-    if(!fun_defs.count(e.fun_name.lexeme())){
+    const FunDef *fp = defs->get_function(e.fun_name.lexeme());
+    if(!fp){
       error("Undefined function call", e.first_token());
     }
     //grab relevant function
-    const FunDef &f = fun_defs[e.fun_name.lexeme()];
+    const FunDef &f = *fp;
+    request_body(fun_name);
 
     //check that func call has right amnt of params
     if(e.args.size() != f.params.size()){
@@ -766,11 +785,11 @@ void SemanticChecker::visit(CallExpr& e)
 
       if(curr_type.type_name != param_type.type_name){
         if(curr_type.type_name != "void"){
-          error("Func call param with incorrect type", e.args[i].first_token());
+          error("Func call param with incorrect type", arena->first_token(e.args[i]));
         }
       }
       if(curr_type.is_array != param_type.is_array){
-        error("Func call param with incorrect array status", e.args[i].first_token());
+        error("Func call param with incorrect array status", arena->first_token(e.args[i]));
       }
 
     }
@@ -782,57 +801,64 @@ void SemanticChecker::visit(CallExpr& e)
 
 void SemanticChecker::visit(Expr& e)
 {
-  //check first part
-  e.first->accept(*this);
- 
-  //set lhstype to curr_type
-  DataType lhs_type = curr_type;
+  span<ExprPart> parts = arena->parts(e);
 
-  //check if op
-  if(e.op.has_value()){
-    //check rest
-    e.rest->accept(*this);
+  //check each term (left to right), saving its type for code generation
+  for(auto& part : parts){
+    arena->accept(part.term, *this);
+    part.type = curr_type;
+  }
+
+  //check each op from the innermost sub-expression out, where the
+  //sub-expression at part i is "term op (rest)" and curr_type holds the
+  //type of rest
+  for(int i = (int) parts.size() - 2; i >= 0; i--){
+    ExprPart& part = parts[i];
+    ExprPart& rest = parts[i + 1];
+
+    //set lhstype to the term's type
+    DataType lhs_type = part.type;
 
     //set rhstype to curr_type
     DataType rhs_type = curr_type;
 
     //store operator str
-    string op_val = e.op.value().lexeme();
-    
+    string op_val = part.op.value().lexeme();
+
     //check if op is MATHEMATICAL
     if(op_val == "+" || op_val == "-" || op_val == "*" || op_val == "/"){
       //check that lhs type is int or double
       if(lhs_type.type_name != "int" && lhs_type.type_name != "double"){
-        error("Illegal var type in math expr", e.op.value());
+        error("Illegal var type in math expr", part.op.value());
       }
       //check that lhs and rhs are not arrays
       if(lhs_type.is_array || rhs_type.is_array){
-        error("Array type in math expr", e.first_token());
+        error("Array type in math expr", arena->first_token(part.term));
       }
       //check if 'rest' has an op
-      if(e.rest->op.has_value()){
-        string op_val = e.rest->op.value().lexeme();
+      if(rest.op.has_value()){
+        string op_val = rest.op.value().lexeme();
         //check if op is math op
         if(op_val != "+" && op_val != "-" && op_val != "*" && op_val != "/"){
-          error("Non mathematical operator in math expr", e.rest->op.value());
+          error("Non mathematical operator in math expr", rest.op.value());
         }
       }
     }else if(op_val == "<" || op_val == ">" || op_val == "<=" || op_val == ">="){//COMPARISON ops
       //check that lhs is int, double, char, string
       if(lhs_type.type_name != "int" && lhs_type.type_name != "double" && lhs_type.type_name != "char" && lhs_type.type_name != "string"){
-        error("Illegal var type in comparison expr", e.op.value());
+        error("Illegal var type in comparison expr", part.op.value());
 
       }
       //check that lhs and rhs not arrays
       if(lhs_type.is_array || rhs_type.is_array){
-        error("Array type in comparison expr", e.first_token());
+        error("Array type in comparison expr", arena->first_token(part.term));
       }
        //check if 'rest' has an op
-      if(e.rest->op.has_value()){
-        string op_val = e.rest->op.value().lexeme();
+      if(rest.op.has_value()){
+        string op_val = rest.op.value().lexeme();
         //check if op is math op
         // if(op_val == "+" || op_val == "-" || op_val == "*" || op_val == "/" || op_val == "and" || op_val == "or"){
-        //   error("Invalid operator in comparison expr", e.rest->op.value());
+        //   error("Invalid operator in comparison expr", rest.op.value());
         // }
       }
       //set curr type to bool
@@ -844,16 +870,16 @@ void SemanticChecker::visit(Expr& e)
         //if not same, check if one or both are void
         if(!(lhs_type.type_name != "void" || rhs_type.type_name != "void")){
           //if neither are void, throw error
-          error("Invalid type in equality expr", e.op.value());
+          error("Invalid type in equality expr", part.op.value());
 
         }
       }
       //check if 'rest' has an op
-      if(e.rest->op.has_value()){
-        string op_val = e.rest->op.value().lexeme();
+      if(rest.op.has_value()){
+        string op_val = rest.op.value().lexeme();
         //check if op is math op (if yes throw error)
         if(op_val == "+" || op_val == "-" || op_val == "*" || op_val == "/" || op_val == "and" || op_val == "or"){
-          error("Invalid operator in equality expr", e.rest->op.value());
+          error("Invalid operator in equality expr", rest.op.value());
         }
       }
       //set curr type to bool
@@ -862,11 +888,11 @@ void SemanticChecker::visit(Expr& e)
     }else if(op_val == "and" || op_val == "or"){//check for LOGICAL ops
 
       //check if 'rest' has op
-      if(e.rest->op.has_value()){
-        string op_val = e.rest->op.value().lexeme();
+      if(rest.op.has_value()){
+        string op_val = rest.op.value().lexeme();
         //check if op is logical op
         if(op_val == "+" || op_val == "-" || op_val == "*" || op_val == "/"){
-          error("Invalid operator in logical expr", e.rest->op.value());
+          error("Invalid operator in logical expr", rest.op.value());
         }
       }
       //set curr type to bool
@@ -877,14 +903,14 @@ void SemanticChecker::visit(Expr& e)
     if(op_val != "==" && op_val != "!="){
       //check if rhs_type and lhs_type are the same!
       if(lhs_type.type_name != rhs_type.type_name){
-        error("Mismatched types in expr", e.op.value());
+        error("Mismatched types in expr", part.op.value());
       }
     }
 
-    if(e.negated){
+    if(part.negated){
       //check that expr type is bool
       if(curr_type.type_name != "bool"){
-        error("Non bool negated expr", e.first_token());
+        error("Non bool negated expr", arena->first_token(part.term));
       }
     }
   }
@@ -894,7 +920,7 @@ void SemanticChecker::visit(Expr& e)
 void SemanticChecker::visit(SimpleTerm& t)
 { 
   //check rvalue
-  t.rvalue->accept(*this);
+  arena->accept(t.rvalue, *this);
 } 
 
 
@@ -903,8 +929,9 @@ void SemanticChecker::visit(ComplexTerm& t)
   //check expr
   t.expr.accept(*this);
   //check if complex term has logical, comparison, or equality ops
-  if(t.expr.op.has_value()){
-    string op_val = t.expr.op.value().lexeme();
+  const optional<Token>& expr_op = arena->parts(t.expr)[0].op;
+  if(expr_op.has_value()){
+    string op_val = expr_op.value().lexeme();
     if(op_val != "+" && op_val != "-" && op_val != "*" && op_val != "/"){
       curr_type = DataType {false, "bool"};
     }
@@ -940,49 +967,58 @@ void SemanticChecker::visit(VarRValue& v)
   for(int i = 0; i < v.path.size(); i++){
 
     if(i == 0){
-      if(!symbol_table.name_exists(v.path[i].var_name.lexeme())){
+      const DataType *var_type = symbol_table.get(v.path[i].var_name.symbol());
+      if(!var_type){
         error("undefined var in varrval path", v.first_token());
 
       }else{
-        rhs_type = symbol_table.get(v.path[i].var_name.lexeme()).value();
+        rhs_type = *var_type;
+        v.path[i].access = AccessKind::VAR;
+        v.path[i].slot = symbol_table.index(v.path[i].var_name.symbol()) - frame_base;
       }
     }
     if(i > 0){
 
       prev_type = rhs_type;
 
-      if(struct_defs.count(prev_type.type_name)){
-        const StructDef &sd = struct_defs[prev_type.type_name];
+      if(defs->get_struct(prev_type.type_name)){
+        const StructDef &sd = *defs->get_struct(prev_type.type_name);
 
         //check field
-        if(!get_field(sd, v.path[i].var_name.lexeme())){
+        const VarDef *field = defs->get_field(sd, v.path[i].var_name.lexeme());
+        if(!field){
           error("Field does not exist in varrval path", v.path[i].var_name);
 
         }else{
-          rhs_type = get_field(sd, v.path[i].var_name.lexeme()).value().data_type;
+          rhs_type = field->data_type;
+          v.path[i].access = AccessKind::FIELD;
+          v.path[i].slot = field - sd.fields.data();
         }
-      }else if(class_defs.count(prev_type.type_name)){
-        const ClassDef &cd = class_defs[prev_type.type_name];
+      }else if(defs->get_class(prev_type.type_name)){
+        const ClassDef &cd = *defs->get_class(prev_type.type_name);
  
         //check public members & methods
         if(!v.path[i].is_method){
-          if(get_member(cd, v.path[i].var_name.lexeme(), "private")){
+          if(defs->get_member(cd, v.path[i].var_name.lexeme(), false)){
             error("member is private", v.path[i].var_name);
 
-          }else if(!get_member(cd, v.path[i].var_name.lexeme(), "public")){
+          }else if(!defs->get_member(cd, v.path[i].var_name.lexeme(), true)){
             error("public member does not exist", v.path[i].var_name);
 
           }else{
-            rhs_type = get_member(cd, v.path[i].var_name.lexeme(), "public").value().data_type;
+            rhs_type = defs->get_member(cd, v.path[i].var_name.lexeme(), true)->data_type;
+            v.path[i].access = AccessKind::MEMBER;
           }
         }else if((v.path[i].is_method)){
-          if(get_method(cd, v.path[i].var_name.lexeme(), "private")){
+          if(defs->get_method(cd, v.path[i].var_name.lexeme(), false)){
             error("method is private", v.path[i].var_name);
 
-          }else if(!get_method(cd, v.path[i].var_name.lexeme(), "public")){
+          }else if(!defs->get_method(cd, v.path[i].var_name.lexeme(), true)){
             error("public method does not exist", v.path[i].var_name);
           }else{
-            rhs_type = get_method(cd, v.path[i].var_name.lexeme(), "public").value().return_type;
+            rhs_type = defs->get_method(cd, v.path[i].var_name.lexeme(), true)->return_type;
+            v.path[i].access = AccessKind::METHOD;
+            request_body(v.path[i].var_name.lexeme());
           }
         }
 
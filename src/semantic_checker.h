@@ -17,6 +17,10 @@ class SemanticChecker : public Visitor
 {
 public:
 
+  // create a checker that checks function bodies on the given number of
+  // worker threads
+  SemanticChecker(unsigned thread_count = 1);
+
   // visitor functions
   void visit(Program& p);
   void visit(FunDef& f);
@@ -41,30 +45,36 @@ private:
   // symbol table
   SymbolTable symbol_table;
 
+  // node storage of the program being checked
+  ASTArena* arena = nullptr;
+
   // current inferred type
   DataType curr_type;
 
-  // mapping from struct names to corresponding ast objects
-  std::unordered_map<std::string, StructDef> struct_defs;
+  // symbol table size when the current function's params are added
+  // (variable frame slots are symbol table indexes relative to it)
+  int frame_base = 0;
 
-  // mapping from function names to corresponding ast objects
-  std::unordered_map<std::string, FunDef> fun_defs;
+  // shared index of the program's struct, function, and class defs
+  DefIndex* defs = nullptr;
 
-  //mapping from class names to corresponding ast objects
-  std::unordered_map<std::string, ClassDef> class_defs;
+  // pre-parsed function bodies still to be parsed and checked
+  std::vector<FunDef*> pending_bodies;
 
-  // helper function to get field in struct def
-  std::optional<VarDef> get_field(const StructDef& struct_def,
-                                  const std::string& field_name);
-  // helper function to get member in class_def
-  std::optional<VarDef> get_member(const ClassDef&, const std::string& member_name, const std::string& visibility);
-  //helper function to get method name in class def
-  std::optional<FunDef> get_method(const ClassDef&, const std::string& method_name, const std::string& visibility);
+  // number of threads used to check function bodies
+  unsigned thread_count = 1;
+
+  // check the bodies of the given functions on the worker threads
+  void check_parallel(std::vector<FunDef>& fun_defs);
 
   // error helper functions
   void error(const std::string& msg, const Token& token);
   void error(const std::string& msg);
 
+  // queue the pre-parsed body of the named function (if any) for
+  // parsing and checking
+  void request_body(const std::string& fun_name);
+
 };
 
 #endif
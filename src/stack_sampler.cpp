@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------
+// FILE: stack_sampler.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the call stack sampler
+//----------------------------------------------------------------------
+
+#include <csignal>
+#include <sys/time.h>
+#include "stack_sampler.h"
+#include "mypl_exception.h"
+
+using namespace std;
+
+
+volatile sig_atomic_t StackSampler::timer_fired = 0;
+
+
+StackSampler::StackSampler(Trigger trigger, long period, bool with_pcs)
+  : trigger(trigger), period(period > 0 ? period : 1), with_pcs(with_pcs),
+    countdown(this->period)
+{
+}
+
+
+StackSampler::~StackSampler()
+{
+  stop();
+}
+
+
+void StackSampler::on_timer(int signal)
+{
+  timer_fired = 1;
+}
+
+
+void StackSampler::start()
+{
+  if (trigger != Trigger::TIMER or started)
+    return;
+  struct sigaction action {};
+  action.sa_handler = on_timer;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  itimerval timer {};
+  timer.it_interval.tv_sec = period / 1000000;
+  timer.it_interval.tv_usec = period % 1000000;
+  timer.it_value = timer.it_interval;
+  if (sigaction(SIGPROF, &action, nullptr) != 0 or
+      setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+    throw MyPLException::VMError("cannot start the sampling timer");
+  timer_fired = 0;
+  started = true;
+}
+
+
+void StackSampler::stop()
+{
+  if (!started)
+    return;
+  itimerval timer {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  signal(SIGPROF, SIG_DFL);
+  timer_fired = 0;
+  started = false;
+}
+
+
+void StackSampler::sample(const vector<shared_ptr<VMFrame>>& call_stack)
+{
+  string stack;
+  for (int i = 0; i < call_stack.size(); ++i) {
+    const VMFrame& frame = *call_stack[i];
+    if (i > 0)
+      stack += ";";
+    stack += frame.info.function_name;
+    if (with_pcs) {
+      // the frames below the top are at the pc after their call
+      int pc = i + 1 < call_stack.size() ? frame.pc - 1 : frame.pc;
+      stack += "@" + to_string(pc);
+    }
+  }
+  ++folded[stack];
+  ++samples;
+}
+
+
+void StackSampler::write_folded(ostream& out) const
+{
+  for (const auto& [stack, count] : folded)
+    out << stack << " " << count << "\n";
+}
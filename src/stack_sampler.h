@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------
+// FILE: stack_sampler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Sampling profiler of MyPL call stacks
+//----------------------------------------------------------------------
+
+#ifndef STACK_SAMPLER_H
+#define STACK_SAMPLER_H
+
+#include <csignal>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "vm_frame.h"
+
+
+// Samples the VM call stack of a RunMode::SAMPLE run at a fixed rate,
+// either every period microseconds of CPU time (via a SIGPROF timer,
+// so only one timer sampler may be started at a time) or every period
+// instructions. The samples are written as folded stacks, one line per
+// distinct stack ("main;f;g 12"), as read by flame graph tools.
+
+class StackSampler
+{
+public:
+
+  enum class Trigger {TIMER, INSTRUCTIONS};
+
+  // if with_pcs is set, each function is followed by the pc it is at
+  // (e.g., "main@3;f@10")
+  StackSampler(Trigger trigger = Trigger::TIMER, long period = 1000,
+               bool with_pcs = false);
+
+  // stops the timer (if started)
+  ~StackSampler();
+
+  StackSampler(const StackSampler&) = delete;
+  StackSampler& operator=(const StackSampler&) = delete;
+
+  // start and stop the timer (no-ops for instruction sampling)
+  void start();
+  void stop();
+
+  // true if a sample should be taken (called once per instruction)
+  bool due();
+
+  // record a call stack (bottom frame first) whose top frame is about
+  // to run the instruction at its pc
+  void sample(const std::vector<std::shared_ptr<VMFrame>>& call_stack);
+
+  // the number of samples taken
+  long sample_count() const {return samples;}
+
+  // the samples of each folded stack
+  const std::map<std::string, long>& stacks() const {return folded;}
+
+  // write the folded stacks
+  void write_folded(std::ostream& out) const;
+
+private:
+
+  Trigger trigger;
+  long period;
+  bool with_pcs;
+  bool started = false;
+
+  // instructions left until the next sample
+  long countdown;
+
+  // set by the SIGPROF handler
+  static volatile std::sig_atomic_t timer_fired;
+  static void on_timer(int signal);
+
+  long samples = 0;
+  std::map<std::string, long> folded;
+
+};
+
+
+inline bool StackSampler::due()
+{
+  if (trigger == Trigger::TIMER) {
+    if (!timer_fired)
+      return false;
+    timer_fired = 0;
+    return true;
+  }
+  if (--countdown > 0)
+    return false;
+  countdown = period;
+  return true;
+}
+
+
+#endif
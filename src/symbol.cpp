@@ -0,0 +1,61 @@
+//----------------------------------------------------------------------
+// FILE: symbol.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of interned identifier names
+//----------------------------------------------------------------------
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "symbol.h"
+
+using namespace std;
+
+
+// the process-wide pool of names (the deque keeps names at stable
+// addresses as it grows)
+class SymbolPool
+{
+public:
+  mutex lock;
+  deque<string> names;
+  unordered_map<string, SymbolId> ids;
+};
+
+
+static SymbolPool& pool()
+{
+  static SymbolPool symbol_pool;
+  return symbol_pool;
+}
+
+
+SymbolId Symbols::intern(const string& name)
+{
+  SymbolPool& p = pool();
+  lock_guard<mutex> guard(p.lock);
+  auto it = p.ids.find(name);
+  if (it != p.ids.end())
+    return it->second;
+  SymbolId id = p.names.size();
+  p.names.push_back(name);
+  p.ids[name] = id;
+  return id;
+}
+
+
+const string& Symbols::name(SymbolId id)
+{
+  SymbolPool& p = pool();
+  lock_guard<mutex> guard(p.lock);
+  return p.names.at(id);
+}
+
+
+SymbolId Symbols::count()
+{
+  SymbolPool& p = pool();
+  lock_guard<mutex> guard(p.lock);
+  return p.names.size();
+}
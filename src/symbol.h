@@ -0,0 +1,39 @@
+//----------------------------------------------------------------------
+// FILE: symbol.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Interface for interned identifier names (symbol ids)
+//----------------------------------------------------------------------
+
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <string>
+
+
+// identifiers are interned by the lexer to small integer ids, so the
+// symbol and var tables can compare and index names without hashing
+// strings
+typedef std::uint32_t SymbolId;
+
+// id of tokens that are not interned (non-identifiers)
+const SymbolId NO_SYMBOL = UINT32_MAX;
+
+
+class Symbols
+{
+public:
+
+  // return the id for the given name, interning the name if needed
+  static SymbolId intern(const std::string& name);
+
+  // return the name of an interned id
+  static const std::string& name(SymbolId id);
+
+  // the number of interned names (ids are 0 to count() - 1)
+  static SymbolId count();
+
+};
+
+#endif
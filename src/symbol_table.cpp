@@ -13,61 +13,91 @@ using namespace std;
 
 void SymbolTable::push_environment()
 {
-  environments.push_back(unordered_map<string,DataType>());
+  environment_starts.push_back(entries.size());
 }
 
 
 void SymbolTable::pop_environment()
 {
-  if (!empty())
-    environments.pop_back();
+  if (empty())
+    return;
+  // unshadow the environment's names, most recent first
+  int start = environment_starts.back();
+  for (int i = entries.size() - 1; i >= start; --i)
+    visible[entries[i].name] = entries[i].shadowed;
+  entries.resize(start);
+  environment_starts.pop_back();
 }
 
 
 bool SymbolTable::empty() const
 {
-  return environments.empty();
+  return environment_starts.empty();
 }
 
 
-void SymbolTable::add(const string& name, const DataType& info)
+int SymbolTable::index(SymbolId name) const
 {
-  if (!empty())
-    environments.back()[name] = info;
+  if (name >= visible.size())
+    return -1;
+  return visible[name];
 }
 
-bool SymbolTable::name_exists(const string& name) const
+
+int SymbolTable::size() const
+{
+  return entries.size();
+}
+
+
+void SymbolTable::add(SymbolId name, const DataType& info)
 {
-  for (int i = environments.size() - 1; i >= 0; --i)
-    if (environments[i].contains(name))
-      return true;
-  return false;
+  if (empty() or name == NO_SYMBOL)
+    return;
+  if (name_exists_in_curr_env(name)) {
+    entries[visible[name]].info = info;
+    return;
+  }
+  if (name >= visible.size())
+    visible.resize(name + 1, -1);
+  entries.push_back(Entry {name, info, visible[name]});
+  visible[name] = entries.size() - 1;
 }
 
+bool SymbolTable::name_exists(SymbolId name) const
+{
+  return index(name) != -1;
+}
 
-bool SymbolTable::name_exists_in_curr_env(const string& name) const
+
+bool SymbolTable::name_exists_in_curr_env(SymbolId name) const
 {
-  return !empty() and environments.back().contains(name);
+  return !empty() and index(name) >= environment_starts.back();
 }
 
 
-optional<DataType> SymbolTable::get(const string& name) const
+const DataType* SymbolTable::get(SymbolId name) const
 {
-  for (int i = environments.size() - 1; i >= 0; --i) 
-    if (environments[i].contains(name))
-      return environments[i].at(name);
-  // couldn't find name, so return null option value
-  return nullopt;
+  int i = index(name);
+  // couldn't find name, so return null
+  if (i == -1)
+    return nullptr;
+  return &entries[i].info;
 }
 
 
 string to_string(const SymbolTable& symbol_table)
 {
   string str = "";
-  for (auto env : symbol_table.environments) {
+  const auto& starts = symbol_table.environment_starts;
+  for (int env = 0; env < starts.size(); ++env) {
+    int end = env + 1 < starts.size() ? starts[env + 1] :
+      symbol_table.entries.size();
     str += "environment: [";
-    for(const auto& [var, type] : env) {
-      str += "\n  " + var + " -> " + type.type_name;
+    for (int i = starts[env]; i < end; ++i) {
+      const DataType& type = symbol_table.entries[i].info;
+      str += "\n  " + Symbols::name(symbol_table.entries[i].name) + " -> " +
+        type.type_name;
       if (type.is_array)
         str += " (is_array = true)";
       else
@@ -77,5 +107,3 @@ string to_string(const SymbolTable& symbol_table)
   }
   return str;
 }
-
-  
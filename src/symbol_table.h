@@ -9,8 +9,8 @@
 #define SYMBOL_TABLE_H
 
 #include <vector>
-#include <unordered_map>
 #include "ast.h"
+#include "symbol.h"
 
 
 class SymbolTable
@@ -25,23 +25,45 @@ public:
   // returns true if the symbol table has no environments
   bool empty() const;
   // add the name, with given type info, to the current environment
-  void add(const std::string& name, const DataType& info);
+  void add(SymbolId name, const DataType& info);
   // true if the name exists in any environment
-  bool name_exists(const std::string& name) const;
+  bool name_exists(SymbolId name) const;
   // true if the name exists in the last pushed environment
-  bool name_exists_in_curr_env(const std::string& name) const;
-  // return the type info for the given name (if the name exists),
-  // searching from most recent to least recent environment (returning
-  // first such match)
-  std::optional<DataType> get(const std::string& name) const;
+  bool name_exists_in_curr_env(SymbolId name) const;
+  // return the type info for the given name (nullptr if the name
+  // doesn't exist), searching from most recent to least recent
+  // environment (returning first such match). The pointer is only
+  // valid until the next add.
+  const DataType* get(SymbolId name) const;
+  // position of the name's visible entry among the entries of all
+  // environments, in declaration order (or -1 if the name doesn't exist)
+  int index(SymbolId name) const;
+  // number of entries in all environments
+  int size() const;
 
   // pretty print the table for debugging
   friend std::string to_string(const SymbolTable& symbol_table);
   
 private:
 
-  // an environment is a mapping from names to type info
-  std::vector<std::unordered_map<std::string,DataType>> environments;
+  // a name declared in some environment
+  class Entry
+  {
+  public:
+    SymbolId name;
+    DataType info;
+    // index of the entry this one shadows (or -1)
+    int shadowed;
+  };
+
+  // all entries of all environments, in declaration order
+  std::vector<Entry> entries;
+
+  // start index (in entries) of each environment
+  std::vector<int> environment_starts;
+
+  // index of the visible entry for each symbol id (or -1)
+  std::vector<int> visible;
 
 };
 
@@ -11,12 +11,18 @@
 
 Token::Token()
   : token_type {TokenType::EOS}, token_lexeme {""}, token_line {0},
-    token_column {0}
+    token_column {0}, token_symbol {NO_SYMBOL}
 {}
 
 Token::Token(TokenType type, const std::string& lexeme, int line, int column)
   : token_type {type}, token_lexeme {lexeme}, token_line {line},
-    token_column {column}
+    token_column {column}, token_symbol {NO_SYMBOL}
+{}
+
+Token::Token(TokenType type, const std::string& lexeme, int line, int column,
+             SymbolId symbol)
+  : token_type {type}, token_lexeme {lexeme}, token_line {line},
+    token_column {column}, token_symbol {symbol}
 {}
 
 TokenType Token::type() const
@@ -39,6 +45,11 @@ int Token::column() const
   return token_column;
 }
 
+SymbolId Token::symbol() const
+{
+  return token_symbol;
+}
+
 std::string to_string(const Token& token)
 {
   std::unordered_map<TokenType,std::string> ts = {
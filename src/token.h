@@ -9,6 +9,7 @@
 #define TOKEN_H
 
 #include <string>
+#include "symbol.h"
 
 
 enum class TokenType {
@@ -39,6 +40,9 @@ public:
   Token();
   // constructor
   Token(TokenType type, const std::string& lexeme, int line, int colum);
+  // constructor for (interned) identifier tokens
+  Token(TokenType type, const std::string& lexeme, int line, int colum,
+        SymbolId symbol);
   // returns the type of the token
   TokenType type() const;
   // returns the lexeme of the token
@@ -47,6 +51,8 @@ public:
   int line() const;
   // returns the column of the token
   int column() const;
+  // returns the interned id of an identifier (NO_SYMBOL otherwise)
+  SymbolId symbol() const;
   // returns the token as a printable string
   friend std::string to_string(const Token& token);
 
@@ -60,6 +66,8 @@ private:
   int token_line;
   // starting column of the token
   int token_column;
+  // interned identifier id
+  SymbolId token_symbol;
 
 };
 
@@ -0,0 +1,134 @@
+//----------------------------------------------------------------------
+// FILE: trace_events.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the trace-event collector and VM profiler
+//----------------------------------------------------------------------
+
+#include <iomanip>
+#include "trace_events.h"
+
+using namespace std;
+
+
+TraceEvents::TraceEvents()
+  : origin(chrono::steady_clock::now())
+{
+}
+
+
+double TraceEvents::now() const
+{
+  chrono::duration<double, micro> t = chrono::steady_clock::now() - origin;
+  return t.count();
+}
+
+
+int TraceEvents::thread_id()
+{
+  auto entry = threads.find(this_thread::get_id());
+  if (entry != threads.end())
+    return entry->second;
+  int id = threads.size();
+  threads[this_thread::get_id()] = id;
+  return id;
+}
+
+
+void TraceEvents::span(const string& name, const string& category,
+                       double start, double duration)
+{
+  lock_guard<mutex> guard(lock);
+  events.push_back({name, category, 'X', start, duration, 0, thread_id()});
+}
+
+
+void TraceEvents::counter(const string& name, double time, long value)
+{
+  lock_guard<mutex> guard(lock);
+  events.push_back({name, "heap", 'C', time, 0, value, thread_id()});
+}
+
+
+int TraceEvents::size() const
+{
+  lock_guard<mutex> guard(lock);
+  return events.size();
+}
+
+
+void TraceEvents::write(ostream& out) const
+{
+  lock_guard<mutex> guard(lock);
+  // names are identifiers or fixed phase names (nothing to escape)
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  out << fixed << setprecision(3);
+  for (int i = 0; i < events.size(); ++i) {
+    const Event& e = events[i];
+    out << (i ? "," : "") << "\n  {\"name\": \"" << e.name
+        << "\", \"cat\": \"" << e.category << "\", \"ph\": \"" << e.phase
+        << "\", \"ts\": " << e.start << ", \"pid\": 1, \"tid\": "
+        << e.thread;
+    if (e.phase == 'X')
+      out << ", \"dur\": " << e.duration;
+    else
+      out << ", \"args\": {\"objects\": " << e.value << "}";
+    out << "}";
+  }
+  out << "\n]}" << endl;
+}
+
+
+TraceProfiler::TraceProfiler(TraceEvents& events, double min_duration)
+  : events(events), min_duration(min_duration)
+{
+}
+
+
+void TraceProfiler::start(const VMFrame& main)
+{
+  calls.clear();
+  calls.push_back({main.info.function_name, events.now()});
+}
+
+
+void TraceProfiler::instruction(const VMFrame& frame, const VMInstr& instr)
+{
+  OpCode op = instr.opcode();
+  if (op != OpCode::ALLOCS and op != OpCode::ALLOCA and op != OpCode::ALLOCC)
+    return;
+  if (++heap_objects == next_heap_report) {
+    events.counter("heap objects", events.now(), heap_objects);
+    next_heap_report *= 2;
+  }
+}
+
+
+void TraceProfiler::call(const VMFrame& caller, const VMFrame& callee)
+{
+  calls.push_back({callee.info.function_name, events.now()});
+}
+
+
+void TraceProfiler::ret(const VMFrame& frame)
+{
+  leave(events.now());
+}
+
+
+void TraceProfiler::end()
+{
+  double now = events.now();
+  while (!calls.empty())
+    leave(now);
+  events.counter("heap objects", now, heap_objects);
+}
+
+
+void TraceProfiler::leave(double now)
+{
+  auto& [name, start] = calls.back();
+  if (now - start >= min_duration)
+    events.span(name, "vm", start, now - start);
+  calls.pop_back();
+}
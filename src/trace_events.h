@@ -0,0 +1,116 @@
+//----------------------------------------------------------------------
+// FILE: trace_events.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Chrome trace-event (Perfetto) export of compile and run spans
+//----------------------------------------------------------------------
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "vm_profiler.h"
+
+
+// Collects timed spans and counter values (safe to add from any
+// thread) and writes them in the Chrome trace-event JSON format, with
+// times in microseconds since the collector was created.
+
+class TraceEvents
+{
+public:
+
+  TraceEvents();
+
+  // microseconds since creation
+  double now() const;
+
+  // add a span (on the calling thread) or a counter value
+  void span(const std::string& name, const std::string& category,
+            double start, double duration);
+  void counter(const std::string& name, double time, long value);
+
+  // run f as a span
+  template<typename F>
+  void time(const std::string& name, const std::string& category, F f);
+
+  // the number of events added
+  int size() const;
+
+  // write the events as a JSON object
+  void write(std::ostream& out) const;
+
+private:
+
+  class Event
+  {
+  public:
+    std::string name;
+    std::string category;
+    char phase;                 // 'X' for spans and 'C' for counters
+    double start;
+    double duration;
+    long value;
+    int thread;
+  };
+
+  std::chrono::steady_clock::time_point origin;
+  mutable std::mutex lock;
+  std::vector<Event> events;
+
+  // small ids of the threads that added events (the first is 0)
+  std::unordered_map<std::thread::id, int> threads;
+  int thread_id();
+
+};
+
+
+template<typename F>
+void TraceEvents::time(const std::string& name, const std::string& category,
+                       F f)
+{
+  double start = now();
+  f();
+  span(name, category, start, now() - start);
+}
+
+
+// Adds a span for each function call of a VM run that lasts at least
+// min_duration microseconds, and a heap object count each time the
+// count doubles (and at the end of the run).
+
+class TraceProfiler : public VMProfiler
+{
+public:
+
+  TraceProfiler(TraceEvents& events, double min_duration = 100);
+
+  void start(const VMFrame& main) override;
+  void instruction(const VMFrame& frame, const VMInstr& instr) override;
+  void call(const VMFrame& caller, const VMFrame& callee) override;
+  void ret(const VMFrame& frame) override;
+  void end() override;
+
+private:
+
+  TraceEvents& events;
+  double min_duration;
+
+  // the running calls and their start times
+  std::vector<std::pair<std::string, double>> calls;
+
+  long heap_objects = 0;
+  long next_heap_report = 1;
+
+  void leave(double now);
+
+};
+
+
+#endif
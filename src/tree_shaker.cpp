@@ -0,0 +1,218 @@
+//----------------------------------------------------------------------
+// FILE: tree_shaker.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation file for dead definition elimination
+//----------------------------------------------------------------------
+
+#include "tree_shaker.h"
+#include "ast_parser.h"
+
+using namespace std;
+
+
+void TreeShaker::visit(Program& p)
+{
+  arena = &p.arena;
+  defs = &p.defs;
+  used_functions.clear();
+  used_types.clear();
+  removed = 0;
+
+  // walk everything reachable from main
+  use_function("main");
+  while (!pending.empty()) {
+    FunDef* f = pending.back();
+    pending.pop_back();
+    f->accept(*this);
+  }
+
+  // drop the rest (only the indexed definition of a name is ever called)
+  size_t old_size = p.fun_defs.size() + p.struct_defs.size() +
+    p.class_defs.size();
+  erase_if(p.fun_defs, [this](FunDef& f) {
+    return defs->get_function(f.fun_name.lexeme()) != &f ||
+      !used_functions.contains(f.fun_name.lexeme());
+  });
+  erase_if(p.struct_defs, [this](StructDef& s) {
+    return !used_types.contains(s.struct_name.lexeme());
+  });
+  erase_if(p.class_defs, [this](ClassDef& c) {
+    return !used_types.contains(c.class_name.lexeme());
+  });
+  removed = old_size - (p.fun_defs.size() + p.struct_defs.size() +
+                        p.class_defs.size());
+
+  // the remaining definitions moved
+  p.defs.build(p);
+}
+
+
+void TreeShaker::use_function(const string& fun_name)
+{
+  if (used_functions.contains(fun_name))
+    return;
+  used_functions.insert(fun_name);
+  FunDef* f = defs->get_function(fun_name);
+  if (f)
+    pending.push_back(f);
+}
+
+
+void TreeShaker::use_type(const string& type_name)
+{
+  if (used_types.contains(type_name))
+    return;
+  used_types.insert(type_name);
+  // a struct or class also needs the types of its fields or members
+  const StructDef* s = defs->get_struct(type_name);
+  if (s) {
+    for (const VarDef& f : s->fields)
+      use_type(f.data_type.type_name);
+  }
+  const ClassDef* c = defs->get_class(type_name);
+  if (c) {
+    for (const VarDef& m : c->public_members)
+      use_type(m.data_type.type_name);
+    for (const VarDef& m : c->private_members)
+      use_type(m.data_type.type_name);
+  }
+}
+
+
+void TreeShaker::visit(vector<StmtRef>& stmts)
+{
+  for (auto& s : stmts)
+    arena->accept(s, *this);
+}
+
+
+void TreeShaker::visit(VarRef& r)
+{
+  if (r.array_expr.has_value())
+    r.array_expr.value().accept(*this);
+  if (r.is_method)
+    use_function(r.var_name.lexeme());
+  for (auto& param : r.method_params) {
+    if (param.has_value())
+      param.value().accept(*this);
+  }
+}
+
+
+void TreeShaker::visit(FunDef& f)
+{
+  // bodies reached from main were already parsed by the checker
+  ASTParser::parse_body(*arena, f);
+  use_type(f.return_type.type_name);
+  for (auto& p : f.params)
+    use_type(p.data_type.type_name);
+  visit(f.stmts);
+}
+
+
+void TreeShaker::visit(StructDef& s)
+{
+}
+
+
+void TreeShaker::visit(ClassDef& c)
+{
+}
+
+
+void TreeShaker::visit(ReturnStmt& s)
+{
+  s.expr.accept(*this);
+}
+
+
+void TreeShaker::visit(WhileStmt& s)
+{
+  s.condition.accept(*this);
+  visit(s.stmts);
+}
+
+
+void TreeShaker::visit(ForStmt& s)
+{
+  s.var_decl.accept(*this);
+  s.condition.accept(*this);
+  s.assign_stmt.accept(*this);
+  visit(s.stmts);
+}
+
+
+void TreeShaker::visit(IfStmt& s)
+{
+  s.if_part.condition.accept(*this);
+  visit(s.if_part.stmts);
+  for (auto& else_if : s.else_ifs) {
+    else_if.condition.accept(*this);
+    visit(else_if.stmts);
+  }
+  visit(s.else_stmts);
+}
+
+
+void TreeShaker::visit(VarDeclStmt& s)
+{
+  use_type(s.var_def.data_type.type_name);
+  s.expr.accept(*this);
+}
+
+
+void TreeShaker::visit(AssignStmt& s)
+{
+  for (auto& r : s.lvalue)
+    visit(r);
+  s.expr.accept(*this);
+}
+
+
+void TreeShaker::visit(CallExpr& e)
+{
+  // built-in names are never user functions (the checker rejects them)
+  use_function(e.fun_name.lexeme());
+  for (auto& arg : e.args)
+    arg.accept(*this);
+}
+
+
+void TreeShaker::visit(Expr& e)
+{
+  for (auto& part : arena->parts(e))
+    arena->accept(part.term, *this);
+}
+
+
+void TreeShaker::visit(SimpleTerm& t)
+{
+  arena->accept(t.rvalue, *this);
+}
+
+
+void TreeShaker::visit(ComplexTerm& t)
+{
+  t.expr.accept(*this);
+}
+
+
+void TreeShaker::visit(SimpleRValue& v)
+{
+}
+
+
+void TreeShaker::visit(NewRValue& v)
+{
+  use_type(v.type.lexeme());
+  if (v.array_expr.has_value())
+    v.array_expr.value().accept(*this);
+}
+
+
+void TreeShaker::visit(VarRValue& v)
+{
+  for (auto& r : v.path)
+    visit(r);
+}
@@ -0,0 +1,68 @@
+//----------------------------------------------------------------------
+// FILE: tree_shaker.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Interface for the dead definition elimination visitor.
+//----------------------------------------------------------------------
+
+
+#ifndef TREE_SHAKER_H
+#define TREE_SHAKER_H
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "ast.h"
+
+
+// Removes the functions, structs, and classes a (semantically checked)
+// program can never reach from main. Calls are followed by name, and a
+// method call keeps every function with the method's name.
+
+class TreeShaker : public Visitor {
+public:
+  void visit(Program& p);
+  void visit(FunDef& f);
+  void visit(StructDef& s);
+  void visit(ClassDef& c);
+  void visit(ReturnStmt& s);
+  void visit(WhileStmt& s);
+  void visit(ForStmt& s);
+  void visit(IfStmt& s);
+  void visit(VarDeclStmt& s);
+  void visit(AssignStmt& s);
+  void visit(CallExpr& e);
+  void visit(Expr& e);
+  void visit(SimpleTerm& t);
+  void visit(ComplexTerm& t);
+  void visit(SimpleRValue& v);
+  void visit(NewRValue& v);
+  void visit(VarRValue& v);
+
+  // number of definitions removed by the last visit
+  int removed_count() const {return removed;}
+
+private:
+
+  ASTArena* arena = nullptr;
+  DefIndex* defs = nullptr;
+
+  // names of the reachable functions and types
+  std::unordered_set<std::string> used_functions;
+  std::unordered_set<std::string> used_types;
+
+  // reachable functions whose bodies are still to be visited
+  std::vector<FunDef*> pending;
+
+  int removed = 0;
+
+  // mark the named function or type (and what it refers to) reachable
+  void use_function(const std::string& fun_name);
+  void use_type(const std::string& type_name);
+
+  void visit(std::vector<StmtRef>& stmts);
+  void visit(VarRef& r);
+
+};
+
+#endif
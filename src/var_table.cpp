@@ -13,52 +13,61 @@ using namespace std;
 
 void VarTable::push_environment()
 {
-  environments.push_back(unordered_map<string,int>());
+  environment_starts.push_back(entries.size());
 }
 
 
 void VarTable::pop_environment()
 {
-  if (!empty()) {
-    next_index -= environments.back().size();
-    environments.pop_back();
-  }
+  if (empty())
+    return;
+  // unshadow the environment's vars, most recent first
+  int start = environment_starts.back();
+  for (int i = entries.size() - 1; i >= start; --i)
+    visible[entries[i].name] = entries[i].shadowed;
+  entries.resize(start);
+  environment_starts.pop_back();
 }
 
 
 bool VarTable::empty() const
 {
-  return environments.empty();
+  return environment_starts.empty();
 }
 
 
-void VarTable::add(const string& name)
+void VarTable::add(SymbolId name)
 {
-  if (!empty())
-    environments.back()[name] = next_index++;
+  if (empty() or name == NO_SYMBOL)
+    return;
+  if (name >= visible.size())
+    visible.resize(name + 1, -1);
+  entries.push_back(Entry {name, visible[name]});
+  visible[name] = entries.size() - 1;
 }
 
 
-int VarTable::get(const string& name) const
+int VarTable::get(SymbolId name) const
 {
-  for (int i = environments.size() - 1; i >= 0; --i) 
-    if (environments[i].contains(name))
-      return environments[i].at(name);
-  // couldn't find name, so return null option value
-  return -1;
+  // couldn't find name, so return -1
+  if (name >= visible.size())
+    return -1;
+  return visible[name];
 }
 
 
 string to_string(const VarTable& var_table)
 {
   string str = "";
-  for (auto env : var_table.environments) {
+  const auto& starts = var_table.environment_starts;
+  for (int env = 0; env < starts.size(); ++env) {
+    int end = env + 1 < starts.size() ? starts[env + 1] :
+      var_table.entries.size();
     str += "environment: [";
-    for(const auto& [var, index] : env)
-      str += "\n  " + var + " -> " + to_string(index);
+    for (int i = starts[env]; i < end; ++i)
+      str += "\n  " + Symbols::name(var_table.entries[i].name) + " -> " +
+        to_string(i);
     str += "\n]\n";
   }
   return str;
 }
-
-  
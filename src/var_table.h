@@ -10,7 +10,7 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include "symbol.h"
 
 
 class VarTable
@@ -27,20 +27,34 @@ public:
   bool empty() const;
 
   // add the var name to the current environment
-  void add(const std::string& name);
+  void add(SymbolId name);
 
   // return index for most recent name (or -1 if the name doesn't exist)
-  int get(const std::string& name) const;
+  int get(SymbolId name) const;
 
   // pretty print the table for debugging
   friend std::string to_string(const VarTable& var_table);
 
 private:
 
-  // an environment is a mapping from names to type info
-  std::vector<std::unordered_map<std::string,int>> environments;
+  // a var declared in some environment (its memory index is its
+  // position in entries)
+  class Entry
+  {
+  public:
+    SymbolId name;
+    // index of the entry this one shadows (or -1)
+    int shadowed;
+  };
 
-  int next_index = 0;
+  // all vars of all environments, in declaration order
+  std::vector<Entry> entries;
+
+  // start index (in entries) of each environment
+  std::vector<int> environment_starts;
+
+  // index of the visible entry for each symbol id (or -1)
+  std::vector<int> visible;
   
 };
 
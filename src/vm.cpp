@@ -5,8 +5,11 @@
 // DESC: VM implementation file
 //----------------------------------------------------------------------
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include "vm.h"
+#include "vm_verifier.h"
 #include "mypl_exception.h"
 
 
@@ -25,6 +28,10 @@ void VM::error(string msg, const VMFrame& frame) const
   string name = frame.info.function_name;
   msg += " (in " + name + " at " + to_string(pc) + ": " +
     to_string(instr) + ")";
+  const VMLineEntry* pos = source_position(frame.info, pc);
+  if (pos)
+    msg += " near line " + to_string(pos->line) + ", column " +
+      to_string(pos->column);
   throw MyPLException::VMError(msg);
 }
 
@@ -34,8 +41,8 @@ string to_string(const VM& vm)
   string s = "";
   for (const auto& entry : vm.frame_info) {
     const string& name = entry.first;
-    s += "\nFrame '" + name + "'\n";
     const VMFrameInfo& frame = entry.second;
+    s += "\nFrame '" + name + "'" + (frame.is_stub ? " (stub)" : "") + "\n";
     for (int i = 0; i < frame.instructions.size(); ++i) {
       VMInstr instr = frame.instructions[i];
       s += "  " + to_string(i) + ": " + to_string(instr) + "\n"; 
@@ -50,42 +57,180 @@ void VM::add(const VMFrameInfo& frame)
   frame_info[frame.function_name] = frame;
 }
 
+void VM::add_stub(const string& function_name, int arg_count)
+{
+  frame_info[function_name] = VMFrameInfo {function_name, arg_count, {}, true};
+}
+
+void VM::set_frame_loader(function<void(const string&)> loader)
+{
+  frame_loader = loader;
+}
+
+const VMFrameInfo& VM::get_frame_info(const string& function_name)
+{
+  VMFrameInfo& info = frame_info[function_name];
+  if (info.is_stub) {
+    // the loader replaces the stub in place (through add)
+    if (frame_loader)
+      frame_loader(function_name);
+    if (info.is_stub)
+      error("no code generated for function '" + function_name + "'");
+  }
+  if (!info.is_verified) {
+    VMVerifier verifier;
+    verifier.verify(info, [this](const string& f) {
+      auto entry = frame_info.find(f);
+      return entry == frame_info.end() ? -1 : entry->second.arg_count;
+    });
+  }
+  return info;
+}
+
+shared_ptr<VMFrame> VM::new_frame(const string& function_name)
+{
+  const VMFrameInfo& info = get_frame_info(function_name);
+  shared_ptr<VMFrame> frame = make_shared<VMFrame>(info);
+  frame->variables.resize(frame->info.local_count, nullptr);
+  vector<VMValue> stack_storage;
+  stack_storage.reserve(frame->info.max_stack);
+  frame->operand_stack = stack<VMValue, vector<VMValue>>(move(stack_storage));
+  return frame;
+}
+
+void VM::set_trace_filter(const string& function_name, int first_pc,
+                          int last_pc)
+{
+  trace_function = function_name;
+  trace_first_pc = first_pc;
+  trace_last_pc = last_pc;
+}
+
+void VM::set_step_handler(function<void(const VMFrame&)> handler)
+{
+  step_handler = handler;
+}
+
+void VM::add_profiler(VMProfiler& profiler)
+{
+  profilers.push_back(&profiler);
+}
+
+void VM::set_sampler(StackSampler& sampler)
+{
+  this->sampler = &sampler;
+}
+
+bool VM::traced(const VMFrame& f) const
+{
+  if (!trace_function.empty() and f.info.function_name != trace_function)
+    return false;
+  return f.pc >= trace_first_pc and (trace_last_pc < 0 or
+                                     f.pc <= trace_last_pc);
+}
+
+void VM::trace(const VMFrame& f) const
+{
+  cerr << endl << endl;
+  cerr << "\t FRAME.........: " << f.info.function_name << endl;
+  cerr << "\t PC............: " << f.pc << endl;
+  cerr << "\t INSTR.........: " << to_string(f.info.instructions[f.pc]) << endl;
+  cerr << "\t NEXT OPERAND..: ";
+  if (!f.operand_stack.empty())
+    cerr << to_string(f.operand_stack.top()) << endl;
+  else
+    cerr << "empty" << endl;
+  cerr << "\t NEXT FUNCTION.: ";
+  if (!call_stack.empty())
+    cerr << call_stack.back()->info.function_name << endl;
+  else
+    cerr << "empty" << endl;
+}
+
 void VM::run(bool DEBUG)
+{
+  if (DEBUG)
+    run(RunMode::TRACE);
+  else if (!profilers.empty())
+    run(RunMode::PROFILE);
+  else
+    run(sampler ? RunMode::SAMPLE : RunMode::PLAIN);
+}
+
+void VM::run(RunMode mode)
+{
+  switch (mode) {
+  case RunMode::PLAIN:
+    run_loop<RunMode::PLAIN>();
+    break;
+  case RunMode::TRACE:
+    run_loop<RunMode::TRACE>();
+    break;
+  case RunMode::PROFILE:
+    run_loop<RunMode::PROFILE>();
+    break;
+  case RunMode::STEP:
+    run_loop<RunMode::STEP>();
+    break;
+  case RunMode::SAMPLE:
+    if (!sampler)
+      error("no sampler to run with");
+    run_loop<RunMode::SAMPLE>();
+    break;
+  }
+}
+
+template<RunMode mode>
+void VM::run_loop()
 {
   // grab the "main" frame if it exists
   if (!frame_info.contains("main"))
     error("No 'main' function");
-  shared_ptr<VMFrame> frame = make_shared<VMFrame>();
-  frame->info = frame_info["main"];
-  call_stack.push(frame);
+  shared_ptr<VMFrame> frame = new_frame("main");
+  call_stack.clear();
+  call_stack.push_back(frame);
+  exit_frame = nullptr;
+  recorder.clear();
+  if constexpr (mode == RunMode::PROFILE) {
+    for (VMProfiler* p : profilers)
+      p->start(*frame);
+  }
 
   // run loop (keep going until we run out of instructions)
   while (!call_stack.empty() and frame->pc < frame->info.instructions.size()) {
 
     // get the next instruction
-    VMInstr& instr = frame->info.instructions[frame->pc];
+    const VMInstr& instr = frame->info.instructions[frame->pc];
+    recorder.record(&frame->info, frame->pc, instr.opcode());
+
+    // instrumentation (compiled out of the plain loop)
+    if constexpr (mode == RunMode::TRACE) {
+      if (traced(*frame))
+        trace(*frame);
+    }
+    if constexpr (mode == RunMode::STEP) {
+      if (traced(*frame)) {
+        if (step_handler)
+          step_handler(*frame);
+        else {
+          trace(*frame);
+          string line;
+          getline(cin, line);
+        }
+      }
+    }
+    if constexpr (mode == RunMode::PROFILE) {
+      for (VMProfiler* p : profilers)
+        p->instruction(*frame, instr);
+    }
+    if constexpr (mode == RunMode::SAMPLE) {
+      if (sampler->due())
+        sampler->sample(call_stack);
+    }
 
     // increment the program counter
     ++frame->pc;
 
-    // for debugging
-    if (DEBUG) {
-      cerr << endl << endl;
-      cerr << "\t FRAME.........: " << frame->info.function_name << endl;
-      cerr << "\t PC............: " << (frame->pc - 1) << endl;
-      cerr << "\t INSTR.........: " << to_string(instr) << endl;
-      cerr << "\t NEXT OPERAND..: ";
-      if (!frame->operand_stack.empty())
-        cerr << to_string(frame->operand_stack.top()) << endl;
-      else
-        cerr << "empty" << endl;
-      cerr << "\t NEXT FUNCTION.: ";
-      if (!call_stack.empty())
-        cerr << call_stack.top()->info.function_name << endl;
-      else
-        cerr << "empty" << endl;
-    }
-
     //----------------------------------------------------------------------
     // Literals and Variables
     //----------------------------------------------------------------------
@@ -99,42 +244,16 @@ void VM::run(bool DEBUG)
     }
 
     else if(instr.opcode() == OpCode::LOAD){
-    
-      VMValue v = instr.operand().value();
-      ensure_not_null(*frame, v);
-      //check for int
-      if(std::holds_alternative<int>(v)){
-        int i = std::get<int>(v);
-
-        //get value from location i and push
-        VMValue val = frame->variables[i];
-        frame->operand_stack.push(val);
-
-      }else{
-        error("Non int index in LOAD instr", *frame);
-      }      
+      //push value from location i (the verifier checked i is a slot)
+      int i = get<int>(*instr.operand());
+      frame->operand_stack.push(frame->variables[i]);
     }
 
     else if(instr.opcode() == OpCode::STORE){
-
-      VMValue v = instr.operand().value();
-      ensure_not_null(*frame, v);
-      //check for int
-      if(std::holds_alternative<int>(v)){
-        int i = std::get<int>(v);
-
-        //check if i is past variables sz
-        if(i == frame->variables.size()){
-          frame->variables.push_back(frame->operand_stack.top());
-        }else{
-          //store top of stack into memory
-          frame->variables[i] = frame->operand_stack.top();
-        }
-        frame->operand_stack.pop();
-
-      }else{
-        error("Non int index in STORE instr", *frame);
-      }      
+      //store top of stack into location i
+      int i = get<int>(*instr.operand());
+      frame->variables[i] = frame->operand_stack.top();
+      frame->operand_stack.pop();
     }
 
     //----------------------------------------------------------------------
@@ -185,6 +304,54 @@ void VM::run(bool DEBUG)
       frame->operand_stack.push(div(y, x));
     }
 
+    else if(instr.opcode() == OpCode::ADD_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y + x);
+    }
+
+    else if(instr.opcode() == OpCode::SUB_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y - x);
+    }
+
+    else if(instr.opcode() == OpCode::MUL_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y * x);
+    }
+
+    else if(instr.opcode() == OpCode::DIV_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y / x);
+    }
+
+    else if(instr.opcode() == OpCode::ADD_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y + x);
+    }
+
+    else if(instr.opcode() == OpCode::SUB_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y - x);
+    }
+
+    else if(instr.opcode() == OpCode::MUL_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y * x);
+    }
+
+    else if(instr.opcode() == OpCode::DIV_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y / x);
+    }
+
     else if(instr.opcode() == OpCode::AND){
         //pop x & y, push x and y
       VMValue x = frame->operand_stack.top();
@@ -277,35 +444,69 @@ void VM::run(bool DEBUG)
       frame->operand_stack.push(!get<bool>(eq(y, x)));
     }
 
+    else if(instr.opcode() == OpCode::CMPLT_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y < x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPLE_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y <= x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPGT_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y > x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPGE_INT){
+      int x = pop_as<int>(*frame);
+      int y = pop_as<int>(*frame);
+      frame->operand_stack.push(y >= x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPLT_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y < x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPLE_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y <= x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPGT_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y > x);
+    }
+
+    else if(instr.opcode() == OpCode::CMPGE_DBL){
+      double x = pop_as<double>(*frame);
+      double y = pop_as<double>(*frame);
+      frame->operand_stack.push(y >= x);
+    }
+
     //----------------------------------------------------------------------
     // Branching
     //----------------------------------------------------------------------
 
     else if(instr.opcode() == OpCode::JMP){
-      //grab operand
-      VMValue i = instr.operand().value();
-      ensure_not_null(*frame, i);
-      //change pc 
-      if(holds_alternative<int>(i)){
-        frame->pc = get<int>(i);
-      }else{
-        error("non int param in JMP", *frame);
-      }
+      //change pc (the verifier checked the target)
+      frame->pc = get<int>(*instr.operand());
     }
 
     else if(instr.opcode() == OpCode::JMPF){
-      //grab operand
-      VMValue i = instr.operand().value();
-      ensure_not_null(*frame, i);
       VMValue x = frame->operand_stack.top();
       ensure_not_null(*frame, x);
       if(get<bool>(x) == false){
         //change pc if false
-        if(holds_alternative<int>(i)){
-         frame->pc = get<int>(i);
-        }else{
-          error("non int param in JMPF", *frame);
-        }
+        frame->pc = get<int>(*instr.operand());
       }
       frame->operand_stack.pop();
     }
@@ -314,36 +515,49 @@ void VM::run(bool DEBUG)
     //----------------------------------------------------------------------
 
     else if(instr.opcode() == OpCode::CALL){
-      //get func name
-      VMValue x = instr.operand().value();
-      ensure_not_null(*frame, x);
       //new func frame
-      shared_ptr<VMFrame> new_frame = make_shared<VMFrame>();
-      //set frame info
-      new_frame->info = frame_info[get<string>(x)];
+      shared_ptr<VMFrame> callee = new_frame(get<string>(*instr.operand()));
       //push frame on call stack
-      call_stack.push(new_frame);
+      call_stack.push_back(callee);
 
       //go through args
-      for(int i = 0; i < new_frame->info.arg_count; i++){
+      for(int i = 0; i < callee->info.arg_count; i++){
         VMValue v = frame->operand_stack.top();
-        new_frame->operand_stack.push(v);
+        callee->operand_stack.push(v);
         frame->operand_stack.pop();
       }
 
+      recorder.record(&callee->info, 0, OpCode::CALL,
+                      FlightRecorder::Event::CALL);
+      if constexpr (mode == RunMode::PROFILE) {
+        for (VMProfiler* p : profilers)
+          p->call(*frame, *callee);
+      }
+
       //set new frame
-      frame = new_frame;
+      frame = callee;
     }
 
     else if(instr.opcode() == OpCode::RET){
       //get ret val
       VMValue v = frame->operand_stack.top();
+      if constexpr (mode == RunMode::PROFILE) {
+        for (VMProfiler* p : profilers)
+          p->ret(*frame);
+      }
       //pop frame
-      call_stack.pop();
+      call_stack.pop_back();
       //if frame exists, push ret val on op stack
       if(!call_stack.empty()){
-        frame = call_stack.top();
+        frame = call_stack.back();
         frame->operand_stack.push(v);
+        recorder.record(&frame->info, frame->pc, OpCode::RET,
+                        FlightRecorder::Event::RETURN);
+      }
+      else {
+        //keep main's variables for the heap snapshot
+        exit_frame = frame;
+        exit_value = v;
       }
       
     }
@@ -485,6 +699,7 @@ void VM::run(bool DEBUG)
     else if(instr.opcode() == OpCode::ALLOCS){
       //add to heap
       struct_heap[next_obj_id] = {};
+      set_object_type(next_obj_id, instr);
       //push obj id
       frame->operand_stack.push(next_obj_id);
       //inc obj id
@@ -495,6 +710,7 @@ void VM::run(bool DEBUG)
     else if(instr.opcode() == OpCode::ALLOCC){
       //add to heap
       class_heap[next_obj_id] = {};
+      set_object_type(next_obj_id, instr);
       //push obj id
       frame->operand_stack.push(next_obj_id);
       //inc obj id
@@ -592,9 +808,9 @@ void VM::run(bool DEBUG)
       ensure_not_null(*frame, x);
       frame->operand_stack.pop();
 
-      //add field to obj
+      //add field to obj (as null)
       VMValue f = instr.operand().value();
-      struct_heap[get<int>(x)].insert({get<string>(f), nullptr});
+      add_struct_field(get<int>(x), get<string>(f), *frame);
 
     }
 
@@ -608,7 +824,7 @@ void VM::run(bool DEBUG)
 
       //set field
       VMValue f = instr.operand().value();
-      struct_heap[get<int>(y)][get<string>(f)] = x;
+      struct_field(get<int>(y), get<string>(f), *frame) = x;
 
     }
 
@@ -620,10 +836,39 @@ void VM::run(bool DEBUG)
       
       //push obj(x).f on stack
       VMValue f = instr.operand().value();
-      frame->operand_stack.push(struct_heap[get<int>(x)][get<string>(f)]);
+      VMValue& field = struct_field(get<int>(x), get<string>(f), *frame);
+      frame->operand_stack.push(field);
 
     }
 
+    else if(instr.opcode() == OpCode::SETF_SLOT){
+      //pop x and y
+      VMValue x = frame->operand_stack.top();
+      frame->operand_stack.pop();
+      int y = pop_as<int>(*frame);
+
+      //set field in slot
+      auto& fields = struct_fields(y, *frame);
+      int i = get<int>(instr.operand().value());
+      if(i >= fields.size()){
+        error("invalid field slot", *frame);
+      }
+      fields[i].second = x;
+    }
+
+    else if(instr.opcode() == OpCode::GETF_SLOT){
+      //pop x
+      int x = pop_as<int>(*frame);
+
+      //push value of field in slot on stack
+      auto& fields = struct_fields(x, *frame);
+      int i = get<int>(instr.operand().value());
+      if(i >= fields.size()){
+        error("invalid field slot", *frame);
+      }
+      frame->operand_stack.push(fields[i].second);
+    }
+
     else if(instr.opcode() == OpCode::SETI){
       //pop x, y, z
       VMValue x = frame->operand_stack.top();
@@ -685,6 +930,216 @@ void VM::run(bool DEBUG)
       error("unsupported operation " + to_string(instr));
     }
   }
+
+  if constexpr (mode == RunMode::PROFILE) {
+    for (VMProfiler* p : profilers)
+      p->end();
+  }
+}
+
+
+void VM::set_object_type(int oid, const VMInstr& instr)
+{
+  const optional<VMValue>& type = instr.operand();
+  if (!type.has_value())
+    return;
+  const string& name = get<string>(type.value());
+  auto entry = type_ids.find(name);
+  if (entry == type_ids.end()) {
+    entry = type_ids.insert({name, type_names.size()}).first;
+    type_names.push_back(name);
+  }
+  object_types[oid] = entry->second;
+}
+
+
+namespace {
+
+  // heap bytes a value uses beyond its own size (long strings only)
+  long extra_bytes(const VMValue& v)
+  {
+    const string* s = get_if<string>(&v);
+    if (s and s->capacity() > string().capacity())
+      return s->capacity() + 1;
+    return 0;
+  }
+  long extra_bytes(const string& s)
+  {
+    return s.capacity() > string().capacity() ? s.capacity() + 1 : 0;
+  }
+
+  // approximate size of a hash table node holding a T (with its
+  // bucket pointer)
+  template<typename T> long node_bytes()
+  {
+    return sizeof(void*) + sizeof(T) + sizeof(size_t) + sizeof(void*);
+  }
+
+}
+
+
+string VM::object_heap(int oid) const
+{
+  if (struct_heap.contains(oid))
+    return "struct";
+  if (array_heap.contains(oid))
+    return "array";
+  if (class_heap.contains(oid))
+    return "class";
+  return "";
+}
+
+
+long VM::object_bytes(int oid) const
+{
+  long bytes = 0;
+  if (auto s = struct_heap.find(oid); s != struct_heap.end()) {
+    bytes = node_bytes<pair<int, vector<pair<string, VMValue>>>>() +
+      s->second.capacity() * sizeof(pair<string, VMValue>);
+    for (auto& [name, value] : s->second)
+      bytes += extra_bytes(name) + extra_bytes(value);
+  }
+  else if (auto a = array_heap.find(oid); a != array_heap.end()) {
+    bytes = node_bytes<pair<int, vector<VMValue>>>() +
+      a->second.capacity() * sizeof(VMValue);
+    for (auto& value : a->second)
+      bytes += extra_bytes(value);
+  }
+  else if (auto c = class_heap.find(oid); c != class_heap.end()) {
+    bytes = node_bytes<pair<int, unordered_map<string, VMValue>>>();
+    for (auto& [name, value] : c->second)
+      bytes += node_bytes<pair<string, VMValue>>() + extra_bytes(name) +
+        extra_bytes(value);
+  }
+  return bytes;
+}
+
+
+vector<int> VM::object_refs(int oid) const
+{
+  vector<int> refs;
+  auto add = [&](const VMValue& v) {
+    const int* to = get_if<int>(&v);
+    if (to and !object_heap(*to).empty())
+      refs.push_back(*to);
+  };
+  if (auto s = struct_heap.find(oid); s != struct_heap.end()) {
+    for (auto& field : s->second)
+      add(field.second);
+  }
+  else if (auto a = array_heap.find(oid); a != array_heap.end()) {
+    for (auto& value : a->second)
+      add(value);
+  }
+  else if (auto c = class_heap.find(oid); c != class_heap.end()) {
+    for (auto& member : c->second)
+      add(member.second);
+  }
+  return refs;
+}
+
+
+vector<VMHeapStats> VM::heap_stats() const
+{
+  // stats by heap and type id (-1 if not known)
+  map<pair<string, int>, VMHeapStats> stats;
+  auto add = [&](int oid, const string& heap) {
+    auto type = object_types.find(oid);
+    int id = type == object_types.end() ? -1 : type->second;
+    VMHeapStats& entry = stats[{heap, id}];
+    entry.heap = heap;
+    entry.type = id < 0 ? "" : type_names[id];
+    ++entry.objects;
+    entry.bytes += object_bytes(oid);
+  };
+  for (auto& entry : struct_heap)
+    add(entry.first, "struct");
+  for (auto& entry : array_heap)
+    add(entry.first, "array");
+  for (auto& entry : class_heap)
+    add(entry.first, "class");
+
+  vector<VMHeapStats> result;
+  for (auto& entry : stats)
+    result.push_back(entry.second);
+  stable_sort(result.begin(), result.end(), [](auto& x, auto& y) {
+    return x.bytes > y.bytes;
+  });
+  return result;
+}
+
+
+void VM::write_heap_snapshot(ostream& out) const
+{
+  // all oids in allocation order
+  vector<int> oids;
+  for (auto& entry : struct_heap)
+    oids.push_back(entry.first);
+  for (auto& entry : array_heap)
+    oids.push_back(entry.first);
+  for (auto& entry : class_heap)
+    oids.push_back(entry.first);
+  sort(oids.begin(), oids.end());
+
+  auto is_ref = [this](const VMValue& v) {
+    const int* oid = get_if<int>(&v);
+    return oid and !object_heap(*oid).empty();
+  };
+  // field (or index) names are MyPL identifiers (nothing to escape)
+  auto write_ref = [&](bool& first, const string& field, const VMValue& v) {
+    if (!is_ref(v))
+      return;
+    out << (first ? "" : ", ") << "{\"field\": \"" << field
+        << "\", \"to\": " << get<int>(v) << "}";
+    first = false;
+  };
+
+  out << "{\"objects\": [";
+  for (int i = 0; i < oids.size(); ++i) {
+    int oid = oids[i];
+    auto type = object_types.find(oid);
+    out << (i ? "," : "") << "\n  {\"id\": " << oid << ", \"heap\": \""
+        << object_heap(oid) << "\", \"type\": \""
+        << (type == object_types.end() ? "" : type_names[type->second])
+        << "\", \"bytes\": " << object_bytes(oid) << ", \"refs\": [";
+    bool first = true;
+    if (auto s = struct_heap.find(oid); s != struct_heap.end()) {
+      for (auto& [name, value] : s->second)
+        write_ref(first, name, value);
+    }
+    else if (auto a = array_heap.find(oid); a != array_heap.end()) {
+      for (int j = 0; j < a->second.size(); ++j)
+        write_ref(first, to_string(j), a->second[j]);
+    }
+    else {
+      // members in name order (for stable output)
+      auto& members = class_heap.at(oid);
+      map<string, VMValue> sorted(members.begin(), members.end());
+      for (auto& [name, value] : sorted)
+        write_ref(first, name, value);
+    }
+    out << "]}";
+  }
+  out << "\n], \"roots\": [";
+  bool first = true;
+  auto write_root = [&](const VMFrame& frame, int slot, const VMValue& v) {
+    if (!is_ref(v))
+      return;
+    out << (first ? "" : ",") << "\n  {\"frame\": \""
+        << frame.info.function_name << "\", \"slot\": " << slot
+        << ", \"to\": " << get<int>(v) << "}";
+    first = false;
+  };
+  for (auto& frame : call_stack) {
+    for (int slot = 0; slot < frame->variables.size(); ++slot)
+      write_root(*frame, slot, frame->variables[slot]);
+  }
+  if (call_stack.empty() and exit_frame) {
+    for (int slot = 0; slot < exit_frame->variables.size(); ++slot)
+      write_root(*exit_frame, slot, exit_frame->variables[slot]);
+    write_root(*exit_frame, -1, exit_value);
+  }
+  out << "\n]}" << endl;
 }
 
 
@@ -695,6 +1150,63 @@ void VM::ensure_not_null(const VMFrame& f, const VMValue& x) const
 }
 
 
+template<typename T>
+T VM::pop_as(VMFrame& f) const
+{
+  const T* x = get_if<T>(&f.operand_stack.top());
+  if (!x) {
+    ensure_not_null(f, f.operand_stack.top());
+    error("unexpected operand type", f);
+  }
+  T val = *x;
+  f.operand_stack.pop();
+  return val;
+}
+
+
+vector<pair<string, VMValue>>& VM::struct_fields(int oid, const VMFrame& f)
+{
+  auto s = struct_heap.find(oid);
+  if (s == struct_heap.end())
+    error("invalid struct object id " + to_string(oid), f);
+  return s->second;
+}
+
+
+void VM::add_struct_field(int oid, const string& field, const VMFrame& f)
+{
+  auto& fields = struct_fields(oid, f);
+  for (auto& entry : fields) {
+    if (entry.first == field)
+      return;
+  }
+  if (auto type = object_types.find(oid); type != object_types.end())
+    field_slots[type->second].insert({field, fields.size()});
+  fields.push_back({field, nullptr});
+}
+
+
+VMValue& VM::struct_field(int oid, const string& field, const VMFrame& f)
+{
+  auto& fields = struct_fields(oid, f);
+  // the field's slot in objects of the type (if the object's fields
+  // were added in the same order)
+  if (auto type = object_types.find(oid); type != object_types.end()) {
+    auto& slots = field_slots[type->second];
+    auto slot = slots.find(field);
+    if (slot != slots.end() and slot->second < fields.size() and
+        fields[slot->second].first == field)
+      return fields[slot->second].second;
+  }
+  for (auto& entry : fields) {
+    if (entry.first == field)
+      return entry.second;
+  }
+  error("invalid field '" + field + "'", f);
+  return fields.front().second;  // not reached
+}
+
+
 VMValue VM::add(const VMValue& x, const VMValue& y) const
 {
   if (holds_alternative<int>(x)) 
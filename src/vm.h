@@ -8,13 +8,39 @@
 #ifndef VM_H
 #define VM_H
 
+#include <functional>
 #include <memory>
+#include <ostream>
 #include <stack>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "vm_instr.h"
 #include "vm_frame.h"
+#include "vm_profiler.h"
+#include "stack_sampler.h"
+#include "flight_recorder.h"
+
+
+// the run loop variants (each compiled separately, so only the ones
+// that need it pay for instrumentation): PLAIN runs the program, TRACE
+// prints each instruction to cerr, PROFILE reports each event to the
+// profilers, STEP stops before each instruction (see
+// set_step_handler), and SAMPLE passes the call stack to the sampler
+// when a sample is due, where TRACE and STEP only report instructions
+// passing the trace filter
+enum class RunMode {PLAIN, TRACE, PROFILE, STEP, SAMPLE};
+
+
+// the live objects of one type in a heap and their approximate size
+class VMHeapStats
+{
+public:
+  std::string heap;             // "struct", "array", or "class"
+  std::string type;             // empty if not known (always for arrays)
+  long objects = 0;
+  long bytes = 0;
+};
 
 
 class VM
@@ -24,8 +50,56 @@ public:
   // add a new frame type to the vm
   void add(const VMFrameInfo& frame);
 
-  // run the virtual machine
+  // add a placeholder frame for a function whose code is generated by
+  // the frame loader (via add) the first time the function is called
+  void add_stub(const std::string& function_name, int arg_count);
+  void set_frame_loader(std::function<void(const std::string&)> loader);
+
+  // run the virtual machine (tracing if DEBUG, else profiling if there
+  // are profilers, else sampling if there is a sampler)
   void run(bool DEBUG = false);
+  void run(RunMode mode);
+
+  // limit tracing and stepping to the named function (any if empty)
+  // and to the pcs from first_pc to last_pc (no limit if negative)
+  void set_trace_filter(const std::string& function_name, int first_pc = 0,
+                        int last_pc = -1);
+
+  // called before each (filtered) instruction in STEP mode, where the
+  // default prints the instruction and waits for a line on cin
+  void set_step_handler(std::function<void(const VMFrame&)> handler);
+
+  // report the events of PROFILE runs to the profiler
+  void add_profiler(VMProfiler& profiler);
+
+  // sample the call stack of SAMPLE runs (the sampler's timer, if any,
+  // is started and stopped by the caller)
+  void set_sampler(StackSampler& sampler);
+
+  // the objects in each heap by type, largest total size first (every
+  // object allocated so far, since objects are never freed)
+  std::vector<VMHeapStats> heap_stats() const;
+
+  // write every heap object with its approximate size and references
+  // as JSON, plus the roots: the variables of the frames still on the
+  // call stack that refer to objects or, after main returned, main's
+  // variables and return value (slot -1) at its return, where an int
+  // value refers to the object with that oid if there is one (so a
+  // large int may be mistaken for a reference)
+  void write_heap_snapshot(std::ostream& out) const;
+
+  // the heap ("struct", "array", or "class") and approximate size of
+  // an object (an empty heap and 0 if there is no such object)
+  std::string object_heap(int oid) const;
+  long object_bytes(int oid) const;
+
+  // the objects an object refers to (as for the heap snapshot)
+  std::vector<int> object_refs(int oid) const;
+
+  // the last events of the current (or last) run, recorded in every
+  // run mode
+  FlightRecorder& flight_recorder() {return recorder;}
+  const FlightRecorder& flight_recorder() const {return recorder;}
 
   // to print the instructions for each VM frame
   friend std::string to_string(const VM& vm);
@@ -33,8 +107,10 @@ public:
   
 private:
 
-  // heap for struct objects mapping oid's to field values
-  std::unordered_map<int, std::unordered_map<std::string, VMValue>> struct_heap;
+  // heap for struct objects mapping oid's to (field name, value) pairs
+  // in the order the fields were added, i.e., a field's slot is its
+  // index in the struct definition
+  std::unordered_map<int, std::vector<std::pair<std::string, VMValue>>> struct_heap;
 
   // heap for array objects
   std::unordered_map<int, std::vector<VMValue>> array_heap;
@@ -45,11 +121,62 @@ private:
   // next available object id 
   int next_obj_id = 2023;
 
+  // the type of each struct and class object allocated with a type
+  // name (as an index into type_names)
+  std::unordered_map<int, int> object_types;
+  std::vector<std::string> type_names;
+  std::unordered_map<std::string, int> type_ids;
+
+  // the slot of each field name in the struct objects of each type (by
+  // type id), for the name-based GETF and SETF
+  std::unordered_map<int, std::unordered_map<std::string, int>> field_slots;
+
+  // record the type of a new object (given by the alloc instruction)
+  void set_object_type(int oid, const VMInstr& instr);
+
   // collection of frame "templates" identified by function name
   std::unordered_map<std::string, VMFrameInfo> frame_info;
 
-  // VM function call stack
-  std::stack<std::shared_ptr<VMFrame>> call_stack;
+  // generates the code of stub frames on first call
+  std::function<void(const std::string&)> frame_loader;
+
+  // the frame "template" of the given function (loading it if a stub
+  // and verifying it on first use)
+  const VMFrameInfo& get_frame_info(const std::string& function_name);
+
+  // a new frame of the given function with its variables and operand
+  // stack sized for the (verified) code
+  std::shared_ptr<VMFrame> new_frame(const std::string& function_name);
+
+  // VM function call stack (the current frame at the back)
+  std::vector<std::shared_ptr<VMFrame>> call_stack;
+
+  // main's frame and return value once main returned (the heap
+  // snapshot roots after the run)
+  std::shared_ptr<VMFrame> exit_frame;
+  VMValue exit_value;
+
+  // the run loop of the given mode
+  template<RunMode mode> void run_loop();
+
+  // trace filter
+  std::string trace_function;
+  int trace_first_pc = 0;
+  int trace_last_pc = -1;
+
+  // true if the instruction at the frame's pc passes the trace filter
+  bool traced(const VMFrame& f) const;
+
+  // print the instruction at the frame's pc to cerr
+  void trace(const VMFrame& f) const;
+
+  std::function<void(const VMFrame&)> step_handler;
+
+  std::vector<VMProfiler*> profilers;
+
+  StackSampler* sampler = nullptr;
+
+  FlightRecorder recorder;
 
   // helper functions to report VM errors
   void error(std::string msg) const;
@@ -58,6 +185,21 @@ private:
   // helper function to check for null values (throws mypl exception)
   void ensure_not_null(const VMFrame& f, const VMValue& x) const;
 
+  // pop the top of the operand stack as a value statically known to be
+  // a T (so only null needs a check)
+  template<typename T> T pop_as(VMFrame& f) const;
+
+  // the fields of a struct obj (an error if there is no such struct)
+  std::vector<std::pair<std::string, VMValue>>& struct_fields(int oid,
+                                                              const VMFrame& f);
+
+  // add the named field to a struct obj as null (if not already there)
+  void add_struct_field(int oid, const std::string& field, const VMFrame& f);
+
+  // the value of the named field of a struct obj (an error if the
+  // struct has no such field)
+  VMValue& struct_field(int oid, const std::string& field, const VMFrame& f);
+
   // operation support helper functions
   VMValue add(const VMValue& x, const VMValue& y) const;
   VMValue sub(const VMValue& x, const VMValue& y) const;  
@@ -9,6 +9,7 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+#include <algorithm>
 #include <stack>
 #include <string>
 #include <vector>
@@ -18,6 +19,17 @@
 // The following are plain-old-data classes
 
 
+// the source position of a frame's code from instruction pc up to the
+// next entry's pc
+class VMLineEntry
+{
+public:
+  int pc;
+  int line;
+  int column;
+};
+
+
 class VMFrameInfo
 {
 public:
@@ -31,6 +43,20 @@ public:
   // the program instructions
   std::vector<VMInstr> instructions;  
 
+  // true if the instructions have not been generated yet (see
+  // VM::add_stub)
+  bool is_stub = false;
+
+  // set once the instructions pass the VMVerifier: the number of
+  // variable slots and the largest operand stack depth they use
+  bool is_verified = false;
+  int local_count = 0;
+  int max_stack = 0;
+
+  // the source positions of the instructions (by increasing pc, with
+  // an entry only where the position changes)
+  std::vector<VMLineEntry> line_table;
+
 };
 
 
@@ -38,18 +64,37 @@ class VMFrame
 {
 public:
 
-  // the type of the current frame
-  VMFrameInfo info;
-  
+  // a frame of the function with the given info
+  VMFrame(const VMFrameInfo& info) : info(info) {}
+
+  // the type of the current frame (the VM's info of the function, which
+  // outlives the frame, so calls do not copy the code and line table)
+  const VMFrameInfo& info;
+
   // the program counter
   int pc = 0;
 
-  // the internal memory of the function
+  // the internal memory of the function (one value per slot)
   std::vector<VMValue> variables;
 
-  // the operand stack
-  std::stack<VMValue> operand_stack;
+  // the operand stack (with room for the frame's max stack depth)
+  std::stack<VMValue, std::vector<VMValue>> operand_stack;
 
 };
 
+
+// the source position of the frame's instruction at pc (nullptr if not
+// known)
+inline const VMLineEntry* source_position(const VMFrameInfo& info, int pc)
+{
+  auto entry = std::upper_bound(info.line_table.begin(),
+                                info.line_table.end(), pc,
+                                [](int pc, const VMLineEntry& e) {
+                                  return pc < e.pc;
+                                });
+  if (entry == info.line_table.begin())
+    return nullptr;
+  return &*(entry - 1);
+}
+
 #endif
@@ -100,6 +100,54 @@ VMInstr VMInstr::DIV()
 }
 
 
+VMInstr VMInstr::ADD_INT()
+{
+  return VMInstr(OpCode::ADD_INT);
+}
+
+
+VMInstr VMInstr::SUB_INT()
+{
+  return VMInstr(OpCode::SUB_INT);
+}
+
+
+VMInstr VMInstr::MUL_INT()
+{
+  return VMInstr(OpCode::MUL_INT);
+}
+
+
+VMInstr VMInstr::DIV_INT()
+{
+  return VMInstr(OpCode::DIV_INT);
+}
+
+
+VMInstr VMInstr::ADD_DBL()
+{
+  return VMInstr(OpCode::ADD_DBL);
+}
+
+
+VMInstr VMInstr::SUB_DBL()
+{
+  return VMInstr(OpCode::SUB_DBL);
+}
+
+
+VMInstr VMInstr::MUL_DBL()
+{
+  return VMInstr(OpCode::MUL_DBL);
+}
+
+
+VMInstr VMInstr::DIV_DBL()
+{
+  return VMInstr(OpCode::DIV_DBL);
+}
+
+
 VMInstr VMInstr::AND()
 {
   return VMInstr(OpCode::AND);
@@ -154,6 +202,54 @@ VMInstr VMInstr::CMPNE()
 }
 
 
+VMInstr VMInstr::CMPLT_INT()
+{
+  return VMInstr(OpCode::CMPLT_INT);
+}
+
+
+VMInstr VMInstr::CMPLE_INT()
+{
+  return VMInstr(OpCode::CMPLE_INT);
+}
+
+
+VMInstr VMInstr::CMPGT_INT()
+{
+  return VMInstr(OpCode::CMPGT_INT);
+}
+
+
+VMInstr VMInstr::CMPGE_INT()
+{
+  return VMInstr(OpCode::CMPGE_INT);
+}
+
+
+VMInstr VMInstr::CMPLT_DBL()
+{
+  return VMInstr(OpCode::CMPLT_DBL);
+}
+
+
+VMInstr VMInstr::CMPLE_DBL()
+{
+  return VMInstr(OpCode::CMPLE_DBL);
+}
+
+
+VMInstr VMInstr::CMPGT_DBL()
+{
+  return VMInstr(OpCode::CMPGT_DBL);
+}
+
+
+VMInstr VMInstr::CMPGE_DBL()
+{
+  return VMInstr(OpCode::CMPGE_DBL);
+}
+
+
 VMInstr VMInstr::JMP(int instruction_index)
 {
   return VMInstr(OpCode::JMP, instruction_index);
@@ -237,6 +333,11 @@ VMInstr VMInstr::ALLOCS()
   return VMInstr(OpCode::ALLOCS);  
 }
 
+VMInstr VMInstr::ALLOCS(const string& type_name)
+{
+  return VMInstr(OpCode::ALLOCS, type_name);
+}
+
 
 VMInstr VMInstr::ALLOCA()
 {
@@ -248,6 +349,11 @@ VMInstr VMInstr::ALLOCC()
   return VMInstr(OpCode::ALLOCC);
 }
 
+VMInstr VMInstr::ALLOCC(const string& type_name)
+{
+  return VMInstr(OpCode::ALLOCC, type_name);
+}
+
 VMInstr VMInstr::ADDF(const string& field)
 {
   return VMInstr(OpCode::ADDF, field);
@@ -266,6 +372,18 @@ VMInstr VMInstr::GETF(const string& field)
 }
 
 
+VMInstr VMInstr::SETF_SLOT(int field_slot)
+{
+  return VMInstr(OpCode::SETF_SLOT, field_slot);
+}
+
+
+VMInstr VMInstr::GETF_SLOT(int field_slot)
+{
+  return VMInstr(OpCode::GETF_SLOT, field_slot);
+}
+
+
 VMInstr VMInstr::SETI()
 {
   return VMInstr(OpCode::SETI);      
@@ -336,18 +454,27 @@ string to_string(const VMValue& val) {
 }
 
 
-std::string to_string(const VMInstr& instr)
+string to_string(OpCode op)
 {
-  std::unordered_map<OpCode, string> os = {
+  static const std::unordered_map<OpCode, string> os = {
     {OpCode::PUSH, "PUSH"}, {OpCode::POP, "POP"},
     {OpCode::LOAD, "LOAD"}, {OpCode::STORE, "STORE"},
     {OpCode::ADD, "ADD"}, {OpCode::SUB, "SUB"},
     {OpCode::MUL, "MUL"}, {OpCode::DIV, "DIV"},
+    {OpCode::ADD_INT, "ADD_INT"}, {OpCode::SUB_INT, "SUB_INT"},
+    {OpCode::MUL_INT, "MUL_INT"}, {OpCode::DIV_INT, "DIV_INT"},
+    {OpCode::ADD_DBL, "ADD_DBL"}, {OpCode::SUB_DBL, "SUB_DBL"},
+    {OpCode::MUL_DBL, "MUL_DBL"}, {OpCode::DIV_DBL, "DIV_DBL"},
     {OpCode::AND, "AND"}, {OpCode::OR, "OR"},
     {OpCode::NOT, "NOT"}, {OpCode::CMPLT, "CMPLT"},
     {OpCode::CMPLE, "CMPLE"}, {OpCode::CMPGT, "CMPGT"},
     {OpCode::CMPGE, "CMPGE"}, {OpCode::CMPEQ, "CMPEQ"}, 
-    {OpCode::CMPNE, "CMPNE"}, {OpCode::JMP, "JMP"},
+    {OpCode::CMPNE, "CMPNE"},
+    {OpCode::CMPLT_INT, "CMPLT_INT"}, {OpCode::CMPLE_INT, "CMPLE_INT"},
+    {OpCode::CMPGT_INT, "CMPGT_INT"}, {OpCode::CMPGE_INT, "CMPGE_INT"},
+    {OpCode::CMPLT_DBL, "CMPLT_DBL"}, {OpCode::CMPLE_DBL, "CMPLE_DBL"},
+    {OpCode::CMPGT_DBL, "CMPGT_DBL"}, {OpCode::CMPGE_DBL, "CMPGE_DBL"},
+    {OpCode::JMP, "JMP"},
     {OpCode::JMPF, "JMPF"}, {OpCode::CALL, "CALL"},
     {OpCode::RET, "RET"}, {OpCode::WRITE, "WRITE"},
     {OpCode::READ, "READ"}, {OpCode::SLEN, "SLEN"},
@@ -358,17 +485,24 @@ std::string to_string(const VMInstr& instr)
     {OpCode::ALLOCC, "ALLOCC"},
     {OpCode::ADDF, "ADDF"}, {OpCode::GETF, "GETF"},
     {OpCode::SETF, "SETF"}, {OpCode::GETI, "GETI"},
+    {OpCode::SETF_SLOT, "SETF_SLOT"}, {OpCode::GETF_SLOT, "GETF_SLOT"},
     {OpCode::SETI, "SETI"}, {OpCode::ADDMEM, "ADDMEM"}, 
     {OpCode::ADDMTH, "ADDMTH"}, {OpCode::SETMEM, "SETMEM"}, 
     {OpCode::SETMTH, "SETMTH"}, {OpCode::GETMEM, "GETMEM"}, 
     {OpCode::GETMTH, "GETMTH"}, {OpCode::DUP, "DUP"},
     {OpCode::NOP, "NOP"}
   };
+  return os.at(op);
+}
+
+
+std::string to_string(const VMInstr& instr)
+{
   string vstr = "";
   if (instr.operand().has_value()) {
     vstr = to_string(instr.operand().value());
   }
-  string s = os[instr.opcode()] + "(" + vstr + ")";
+  string s = to_string(instr.opcode()) + "(" + vstr + ")";
   if (instr.instr_comment != "")
     s += "  // " + instr.instr_comment;
   return s;
@@ -21,6 +21,9 @@ typedef std::variant<int, double, bool, std::string, std::nullptr_t> VMValue;
 // function to get a string representation of a vm_value
 std::string to_string(const VMValue& val);
 
+// the name of an opcode
+std::string to_string(OpCode op);
+
 
 class VMInstr
 {
@@ -35,6 +38,14 @@ public:
   static VMInstr SUB();
   static VMInstr MUL();
   static VMInstr DIV();
+  static VMInstr ADD_INT();
+  static VMInstr SUB_INT();
+  static VMInstr MUL_INT();
+  static VMInstr DIV_INT();
+  static VMInstr ADD_DBL();
+  static VMInstr SUB_DBL();
+  static VMInstr MUL_DBL();
+  static VMInstr DIV_DBL();
   static VMInstr AND();
   static VMInstr OR();
   static VMInstr NOT();
@@ -44,6 +55,14 @@ public:
   static VMInstr CMPGE();
   static VMInstr CMPEQ();
   static VMInstr CMPNE();
+  static VMInstr CMPLT_INT();
+  static VMInstr CMPLE_INT();
+  static VMInstr CMPGT_INT();
+  static VMInstr CMPGE_INT();
+  static VMInstr CMPLT_DBL();
+  static VMInstr CMPLE_DBL();
+  static VMInstr CMPGT_DBL();
+  static VMInstr CMPGE_DBL();
   static VMInstr JMP(int instruction_index);
   static VMInstr JMPF(int instruction_index);
   static VMInstr CALL(const std::string& function);
@@ -58,11 +77,15 @@ public:
   static VMInstr TOSTR();
   static VMInstr CONCAT();
   static VMInstr ALLOCS();
+  static VMInstr ALLOCS(const std::string& type_name);
   static VMInstr ALLOCA();
   static VMInstr ALLOCC();
+  static VMInstr ALLOCC(const std::string& type_name);
   static VMInstr ADDF(const std::string& field);
   static VMInstr SETF(const std::string& field);
   static VMInstr GETF(const std::string& field);
+  static VMInstr SETF_SLOT(int field_slot);
+  static VMInstr GETF_SLOT(int field_slot);
   static VMInstr SETI();
   static VMInstr GETI();  
   static VMInstr ADDMEM(const std::string& mem);
@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------
+// FILE: vm_profiler.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Interface for observers of a profiled VM run
+//----------------------------------------------------------------------
+
+#ifndef VM_PROFILER_H
+#define VM_PROFILER_H
+
+#include <chrono>
+#include "vm_frame.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// Receives the events of a VM run in RunMode::PROFILE (see
+// VM::add_profiler). The other run modes never call a profiler.
+
+class VMProfiler
+{
+public:
+
+  virtual ~VMProfiler() {}
+
+  // after the main frame is pushed
+  virtual void start(const VMFrame& main) {}
+
+  // before the instruction at frame.pc is executed
+  virtual void instruction(const VMFrame& frame, const VMInstr& instr) {}
+
+  // after the callee frame is pushed (with its args) by the caller
+  virtual void call(const VMFrame& caller, const VMFrame& callee) {}
+
+  // before the returning frame is popped
+  virtual void ret(const VMFrame& frame) {}
+
+  // after the last instruction of a run that did not fail
+  virtual void end() {}
+
+};
+
+
+
+// the current time for timing instructions, in cycles (read from the
+// time-stamp counter on x86) or else in nanoseconds, and its unit
+inline long profile_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline const char* profile_tick_unit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return "cycles";
+#else
+  return "ns";
+#endif
+}
+
+
+#endif
@@ -0,0 +1,413 @@
+//----------------------------------------------------------------------
+// FILE: vm_verifier.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the VM frame code verifier
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include "vm_verifier.h"
+#include "mypl_exception.h"
+
+using namespace std;
+
+
+void VMVerifier::verify(VMFrameInfo& f,
+                        const function<int(const string&)>& arg_count)
+{
+  frame = &f;
+  this->arg_count = arg_count;
+  int n = f.instructions.size();
+  block_states.clear();
+  depths.assign(n, -1);
+  worklist.clear();
+
+  // find the variable slots (each is stored before it is loaded) and
+  // the basic blocks
+  local_count = 0;
+  block_start.assign(n, false);
+  if (n > 0)
+    block_start[0] = true;
+  for (int i = 0; i < n; ++i) {
+    OpCode op = f.instructions[i].opcode();
+    if (op == OpCode::STORE)
+      local_count = max(local_count, int_operand(i) + 1);
+    if (op == OpCode::JMP or op == OpCode::JMPF) {
+      int target = int_operand(i);
+      if (target > n)
+        error("jump out of the frame", i);
+      if (target < n)
+        block_start[target] = true;
+    }
+    if ((op == OpCode::JMP or op == OpCode::JMPF or op == OpCode::RET) and
+        i + 1 < n)
+      block_start[i + 1] = true;
+  }
+
+  // the args are on the operand stack when the frame starts
+  int max_stack = f.arg_count;
+  if (n > 0)
+    merge(0, vector<ValueType>(f.arg_count, ValueType::ANY), 0);
+
+  while (!worklist.empty()) {
+    int start = worklist.back();
+    worklist.pop_back();
+    vector<ValueType> stack = block_states[start];
+    // run the block's instructions
+    for (int i = start; i < n; ++i) {
+      depths[i] = stack.size();
+      int jump_target = -1;
+      bool falls_through = true;
+      step(i, stack, jump_target, falls_through);
+      max_stack = max(max_stack, (int) stack.size());
+      // a successor one past the last instruction ends the frame
+      if (jump_target >= 0 and jump_target < n)
+        merge(jump_target, stack, i);
+      if (!falls_through)
+        break;
+      if (i + 1 < n and block_start[i + 1]) {
+        merge(i + 1, stack, i);
+        break;
+      }
+    }
+  }
+
+  f.local_count = local_count;
+  f.max_stack = max_stack;
+  f.is_verified = true;
+}
+
+
+int VMVerifier::stack_depth(int i) const
+{
+  return depths[i];
+}
+
+
+optional<vector<VMVerifier::ValueType>> VMVerifier::stack_types(int i) const
+{
+  if (depths[i] < 0)
+    return nullopt;
+  // replay the instruction's block up to it
+  int start = i;
+  while (!block_start[start])
+    --start;
+  vector<ValueType> stack = block_states.at(start);
+  for (int j = start; j < i; ++j) {
+    int jump_target = -1;
+    bool falls_through = true;
+    step(j, stack, jump_target, falls_through);
+  }
+  return stack;
+}
+
+
+void VMVerifier::step(int i, vector<ValueType>& stack, int& jump_target,
+                      bool& falls_through) const
+{
+  const VMInstr& instr = frame->instructions[i];
+
+  // stack helpers (null and unknown values are allowed anywhere, e.g.,
+  // an int variable may hold null)
+  auto pop = [&](ValueType expected) {
+    if (stack.empty())
+      error("operand stack underflow", i);
+    ValueType t = stack.back();
+    if (expected != ValueType::ANY and t != ValueType::ANY and
+        t != ValueType::NULL_VALUE and t != expected)
+      error("operand of wrong type", i);
+    stack.pop_back();
+    return t;
+  };
+  auto pop_number = [&]() {
+    ValueType t = pop(ValueType::ANY);
+    if (t == ValueType::BOOL or t == ValueType::STRING)
+      error("non-numeric operand", i);
+    return t;
+  };
+  auto push = [&](ValueType t) {
+    stack.push_back(t);
+  };
+
+  switch (instr.opcode()) {
+
+  // consts/vars
+  case OpCode::PUSH: {
+    optional<VMValue> v = instr.operand();
+    if (!v.has_value())
+      error("missing operand", i);
+    if (holds_alternative<int>(v.value()))
+      push(ValueType::INT);
+    else if (holds_alternative<double>(v.value()))
+      push(ValueType::DOUBLE);
+    else if (holds_alternative<bool>(v.value()))
+      push(ValueType::BOOL);
+    else if (holds_alternative<string>(v.value()))
+      push(ValueType::STRING);
+    else
+      push(ValueType::NULL_VALUE);
+    break;
+  }
+  case OpCode::POP:
+    pop(ValueType::ANY);
+    break;
+  case OpCode::LOAD:
+    if (int_operand(i) >= local_count)
+      error("load of a variable that is never stored", i);
+    push(ValueType::ANY);
+    break;
+  case OpCode::STORE:
+    pop(ValueType::ANY);
+    break;
+
+  // arithmetic ops
+  case OpCode::ADD:
+  case OpCode::SUB:
+  case OpCode::MUL:
+  case OpCode::DIV: {
+    ValueType x = pop_number();
+    ValueType y = pop_number();
+    push(x == y ? x : ValueType::ANY);
+    break;
+  }
+  case OpCode::ADD_INT:
+  case OpCode::SUB_INT:
+  case OpCode::MUL_INT:
+  case OpCode::DIV_INT:
+    pop(ValueType::INT);
+    pop(ValueType::INT);
+    push(ValueType::INT);
+    break;
+  case OpCode::ADD_DBL:
+  case OpCode::SUB_DBL:
+  case OpCode::MUL_DBL:
+  case OpCode::DIV_DBL:
+    pop(ValueType::DOUBLE);
+    pop(ValueType::DOUBLE);
+    push(ValueType::DOUBLE);
+    break;
+
+  // logical operators
+  case OpCode::AND:
+  case OpCode::OR:
+    pop(ValueType::BOOL);
+    pop(ValueType::BOOL);
+    push(ValueType::BOOL);
+    break;
+  case OpCode::NOT:
+    pop(ValueType::BOOL);
+    push(ValueType::BOOL);
+    break;
+
+  // comparators
+  case OpCode::CMPLT:
+  case OpCode::CMPLE:
+  case OpCode::CMPGT:
+  case OpCode::CMPGE:
+  case OpCode::CMPEQ:
+  case OpCode::CMPNE:
+    pop(ValueType::ANY);
+    pop(ValueType::ANY);
+    push(ValueType::BOOL);
+    break;
+  case OpCode::CMPLT_INT:
+  case OpCode::CMPLE_INT:
+  case OpCode::CMPGT_INT:
+  case OpCode::CMPGE_INT:
+    pop(ValueType::INT);
+    pop(ValueType::INT);
+    push(ValueType::BOOL);
+    break;
+  case OpCode::CMPLT_DBL:
+  case OpCode::CMPLE_DBL:
+  case OpCode::CMPGT_DBL:
+  case OpCode::CMPGE_DBL:
+    pop(ValueType::DOUBLE);
+    pop(ValueType::DOUBLE);
+    push(ValueType::BOOL);
+    break;
+
+  // jump
+  case OpCode::JMP:
+    jump_target = int_operand(i);
+    falls_through = false;
+    break;
+  case OpCode::JMPF:
+    jump_target = int_operand(i);
+    pop(ValueType::BOOL);
+    break;
+
+  // functions
+  case OpCode::CALL: {
+    string fun_name = string_operand(i);
+    int argc = arg_count(fun_name);
+    if (argc < 0)
+      error("call to undefined function '" + fun_name + "'", i);
+    for (int j = 0; j < argc; ++j)
+      pop(ValueType::ANY);
+    push(ValueType::ANY);
+    break;
+  }
+  case OpCode::RET:
+    pop(ValueType::ANY);
+    falls_through = false;
+    break;
+
+  // built-ins
+  case OpCode::WRITE:
+    pop(ValueType::ANY);
+    break;
+  case OpCode::READ:
+    push(ValueType::STRING);
+    break;
+  case OpCode::SLEN:
+    pop(ValueType::STRING);
+    push(ValueType::INT);
+    break;
+  case OpCode::ALEN:
+    pop(ValueType::INT);
+    push(ValueType::INT);
+    break;
+  case OpCode::GETC:
+    pop(ValueType::STRING);
+    pop(ValueType::INT);
+    push(ValueType::STRING);
+    break;
+  case OpCode::TOINT:
+    pop(ValueType::ANY);
+    push(ValueType::INT);
+    break;
+  case OpCode::TODBL:
+    pop(ValueType::ANY);
+    push(ValueType::DOUBLE);
+    break;
+  case OpCode::TOSTR:
+    pop_number();
+    push(ValueType::STRING);
+    break;
+  case OpCode::CONCAT:
+    pop(ValueType::STRING);
+    pop(ValueType::STRING);
+    push(ValueType::STRING);
+    break;
+
+  // heap (objects are referred to by int oids)
+  case OpCode::ALLOCS:
+  case OpCode::ALLOCC:
+    // the (optional) type name
+    if (instr.operand().has_value())
+      string_operand(i);
+    push(ValueType::INT);
+    break;
+  case OpCode::ALLOCA:
+    pop(ValueType::ANY);
+    pop(ValueType::INT);
+    push(ValueType::INT);
+    break;
+  case OpCode::ADDF:
+  case OpCode::ADDMEM:
+  case OpCode::ADDMTH:
+    string_operand(i);
+    pop(ValueType::INT);
+    break;
+  case OpCode::SETF:
+  case OpCode::SETMEM:
+  case OpCode::SETMTH:
+    string_operand(i);
+    pop(ValueType::ANY);
+    pop(ValueType::INT);
+    break;
+  case OpCode::GETF:
+  case OpCode::GETMEM:
+  case OpCode::GETMTH:
+    string_operand(i);
+    pop(ValueType::INT);
+    push(ValueType::ANY);
+    break;
+  case OpCode::SETF_SLOT:
+    int_operand(i);
+    pop(ValueType::ANY);
+    pop(ValueType::INT);
+    break;
+  case OpCode::GETF_SLOT:
+    int_operand(i);
+    pop(ValueType::INT);
+    push(ValueType::ANY);
+    break;
+  case OpCode::SETI:
+    pop(ValueType::ANY);
+    pop(ValueType::INT);
+    pop(ValueType::INT);
+    break;
+  case OpCode::GETI:
+    pop(ValueType::INT);
+    pop(ValueType::INT);
+    push(ValueType::ANY);
+    break;
+
+  // special
+  case OpCode::DUP: {
+    ValueType t = pop(ValueType::ANY);
+    push(t);
+    push(t);
+    break;
+  }
+  case OpCode::NOP:
+    break;
+
+  default:
+    error("unsupported operation", i);
+  }
+}
+
+
+void VMVerifier::merge(int i, const vector<ValueType>& stack, int from)
+{
+  auto entry = block_states.find(i);
+  if (entry == block_states.end()) {
+    block_states[i] = stack;
+    worklist.push_back(i);
+    return;
+  }
+  vector<ValueType>& state = entry->second;
+  if (state.size() != stack.size())
+    error("operand stack depth differs from that after instruction " +
+          to_string(from), i);
+  // types that differ between paths are unknown
+  bool changed = false;
+  for (int j = 0; j < state.size(); ++j) {
+    if (state[j] != stack[j] and state[j] != ValueType::ANY) {
+      state[j] = ValueType::ANY;
+      changed = true;
+    }
+  }
+  if (changed)
+    worklist.push_back(i);
+}
+
+
+int VMVerifier::int_operand(int i) const
+{
+  optional<VMValue> v = frame->instructions[i].operand();
+  if (!v.has_value() or !holds_alternative<int>(v.value()) or
+      get<int>(v.value()) < 0)
+    error("expecting a non-negative int operand", i);
+  return get<int>(v.value());
+}
+
+
+string VMVerifier::string_operand(int i) const
+{
+  optional<VMValue> v = frame->instructions[i].operand();
+  if (!v.has_value() or !holds_alternative<string>(v.value()))
+    error("expecting a string operand", i);
+  return get<string>(v.value());
+}
+
+
+void VMVerifier::error(const string& msg, int i) const
+{
+  string s = msg + " (in " + frame->function_name + " at " + to_string(i) +
+    ": " + to_string(frame->instructions[i]) + ")";
+  throw MyPLException::VMError(s);
+}
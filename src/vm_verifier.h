@@ -0,0 +1,84 @@
+//----------------------------------------------------------------------
+// FILE: vm_verifier.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Static checks of VM frame code before it is run
+//----------------------------------------------------------------------
+
+#ifndef VM_VERIFIER_H
+#define VM_VERIFIER_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "vm_frame.h"
+
+
+// Walks every path through a frame's instructions, tracking the depth
+// and value types of the operand stack, and rejects code that could
+// underflow the stack, reach a join point with different stack depths,
+// jump out of the frame, load a variable slot that is never stored,
+// call an undefined function, or apply an op to a value of the wrong
+// type. The frame's variable count and largest stack depth are recorded
+// so it can run on fixed-size storage without further checks.
+
+class VMVerifier
+{
+public:
+
+  // the value types tracked on the operand stack (ANY if unknown)
+  enum class ValueType {ANY, INT, DOUBLE, BOOL, STRING, NULL_VALUE};
+
+  // verify the frame (throwing a VM error if malformed) and set its
+  // local_count, max_stack, and is_verified, where arg_count gives the
+  // number of args of the named function (or -1 if it doesn't exist)
+  void verify(VMFrameInfo& frame,
+              const std::function<int(const std::string&)>& arg_count);
+
+  // the operand stack depth and types (bottom first) before the i-th
+  // instruction of the last verified frame (-1 and nullopt if the
+  // instruction is never reached)
+  int stack_depth(int i) const;
+  std::optional<std::vector<ValueType>> stack_types(int i) const;
+
+private:
+
+  // the frame being verified
+  const VMFrameInfo* frame = nullptr;
+  std::function<int(const std::string&)> arg_count;
+  int local_count = 0;
+
+  // true for instructions that start a basic block (the first one,
+  // jump targets, and those following a jump or return)
+  std::vector<bool> block_start;
+
+  // stack state at the start of each reached block
+  std::unordered_map<int, std::vector<ValueType>> block_states;
+
+  // stack depth before each instruction (-1 if not reached)
+  std::vector<int> depths;
+
+  // blocks whose code needs (re)visiting
+  std::vector<int> worklist;
+
+  // apply the i-th instruction to the stack, setting its jump target
+  // (-1 if none) and whether it can fall through to the next one
+  void step(int i, std::vector<ValueType>& stack, int& jump_target,
+            bool& falls_through) const;
+
+  // merge a stack state into the state at the start of block i
+  void merge(int i, const std::vector<ValueType>& stack, int from);
+
+  // operand helpers
+  int int_operand(int i) const;
+  std::string string_operand(int i) const;
+
+  // error helper (reporting the instruction at index i)
+  [[noreturn]] void error(const std::string& msg, int i) const;
+
+};
+
+
+#endif
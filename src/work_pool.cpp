@@ -0,0 +1,54 @@
+//----------------------------------------------------------------------
+// FILE: work_pool.cpp
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Implementation of the worker pool
+//----------------------------------------------------------------------
+
+#include <atomic>
+#include <thread>
+#include "work_pool.h"
+
+using namespace std;
+
+
+unsigned WorkPool::default_size()
+{
+  unsigned n = thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+
+vector<exception_ptr> WorkPool::run(size_t count, unsigned worker_count,
+                                    const function<void(unsigned, size_t)>& task)
+{
+  vector<exception_ptr> errors(count);
+  atomic<size_t> next {0};
+  // each worker claims the next unclaimed task until none are left
+  auto work = [&](unsigned worker) {
+    for (size_t i = next++; i < count; i = next++) {
+      try {
+        task(worker, i);
+      } catch (...) {
+        errors[i] = current_exception();
+      }
+    }
+  };
+  if (worker_count < 1)
+    worker_count = 1;
+  vector<thread> threads;
+  for (unsigned w = 1; w < worker_count && w < count; ++w)
+    threads.emplace_back(work, w);
+  work(0);
+  for (thread& t : threads)
+    t.join();
+  return errors;
+}
+
+
+void WorkPool::rethrow_first(const vector<exception_ptr>& errors)
+{
+  for (const exception_ptr& e : errors)
+    if (e)
+      rethrow_exception(e);
+}
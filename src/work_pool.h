@@ -0,0 +1,38 @@
+//----------------------------------------------------------------------
+// FILE: work_pool.h
+// DATE: CPSC 326, Spring 2023
+// AUTH: Carolyn Bozin
+// DESC: Minimal worker pool for running independent tasks in parallel
+//----------------------------------------------------------------------
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <vector>
+
+
+class WorkPool
+{
+public:
+
+  // the default number of worker threads (one per core)
+  static unsigned default_size();
+
+  // run task(worker, i) for each i in [0, count) on up to worker_count
+  // threads, where worker identifies the thread (0 to worker_count-1)
+  // running the task. Returns the exception (if any) thrown by each
+  // task, indexed by i.
+  static std::vector<std::exception_ptr> run(
+    std::size_t count, unsigned worker_count,
+    const std::function<void(unsigned, std::size_t)>& task);
+
+  // rethrow the first (lowest index) exception, if any
+  static void rethrow_first(const std::vector<std::exception_ptr>& errors);
+
+};
+
+
+#endif
@@ -6,17 +6,30 @@
 //----------------------------------------------------------------------
 
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <gtest/gtest.h>
 #include "mypl_exception.h"
 #include "lexer.h"
+#include "pipelined_lexer.h"
 #include "simple_parser.h"
 #include "ast_parser.h"
 #include "semantic_checker.h"
 #include "vm.h"
+#include "vm_verifier.h"
+#include "run_stats.h"
+#include "opcode_profiler.h"
+#include "line_profiler.h"
+#include "call_profiler.h"
+#include "trace_events.h"
+#include "allocation_profiler.h"
+#include "flight_recorder.h"
 #include "vm_frame.h"
 #include "code_generator.h"
+#include "tree_shaker.h"
+#include "symbol_table.h"
+#include "var_table.h"
 
 using namespace std;
 
@@ -242,6 +255,81 @@ TEST(BasicClassTests, BadSimpleClassMethodCallWithParams) {
 // AST parser tests
 //----------------------------------------------------------------------
 
+TEST(BasicClassTests, InternedSymbolScopes) {
+  stringstream in("x y x\n");
+  Lexer lexer(in);
+  Token x1 = lexer.next_token();
+  Token y = lexer.next_token();
+  Token x2 = lexer.next_token();
+  ASSERT_EQ(x1.symbol(), x2.symbol());
+  ASSERT_NE(x1.symbol(), y.symbol());
+  ASSERT_EQ("x", Symbols::name(x1.symbol()));
+  SymbolTable table;
+  table.push_environment();
+  table.add(x1.symbol(), DataType {false, "int"});
+  table.push_environment();
+  table.add(x1.symbol(), DataType {true, "string"});
+  ASSERT_EQ("string", table.get(x2.symbol())->type_name);
+  ASSERT_EQ(nullptr, table.get(y.symbol()));
+  table.pop_environment();
+  ASSERT_EQ("int", table.get(x2.symbol())->type_name);
+  ASSERT_TRUE(table.name_exists_in_curr_env(x1.symbol()));
+  VarTable vars;
+  vars.push_environment();
+  vars.add(x1.symbol());
+  vars.push_environment();
+  vars.add(y.symbol());
+  vars.add(x1.symbol());
+  ASSERT_EQ(2, vars.get(x1.symbol()));
+  vars.pop_environment();
+  ASSERT_EQ(0, vars.get(x1.symbol()));
+  ASSERT_EQ(-1, vars.get(y.symbol()));
+}
+
+TEST(BasicClassTests, PipelinedLexerMatchesLexer) {
+  string src = build_string({
+      "class C {public: int x}",
+      "void main() {",
+      "  for (int i = 0; i < 10; i = i + 1) {print(to_string(i * 2.5))}",
+      "}"
+    });
+  stringstream in1(src);
+  stringstream in2(src);
+  Lexer lexer(in1);
+  // a tiny ring so the producer wraps around and blocks
+  PipelinedLexer tokens(Lexer(in2), 4);
+  Token t1, t2;
+  do {
+    t1 = lexer.next_token();
+    t2 = tokens.next_token();
+    ASSERT_EQ(to_string(t1), to_string(t2));
+    ASSERT_EQ(t1.symbol(), t2.symbol());
+  } while (t1.type() != TokenType::EOS);
+  ASSERT_EQ(TokenType::EOS, tokens.next_token().type());
+  // other capacities are rounded up to a power of 2
+  for (size_t capacity : {0, 3, 5}) {
+    stringstream in4(src);
+    stringstream in5(src);
+    Lexer lexer(in4);
+    PipelinedLexer tokens(Lexer(in5), capacity);
+    do {
+      t1 = lexer.next_token();
+      t2 = tokens.next_token();
+      ASSERT_EQ(to_string(t1), to_string(t2));
+    } while (t1.type() != TokenType::EOS);
+  }
+  // lexer errors reach the parser where they occur in the stream
+  stringstream in3("void main() {\n  int x = 1\n  int y = @\n}\n");
+  try {
+    PipelinedLexer bad_tokens {Lexer(in3)};
+    ASTParser(bad_tokens).parse();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("Lexer Error: ", msg.substr(0, 13));
+  }
+}
+
 TEST(BasicClassTests, ASTEmptyInput) {
   stringstream in("");
   Program p = ASTParser(Lexer(in)).parse();
@@ -441,6 +529,349 @@ TEST(BasicClassTests, ASTClassMethodCallPublicWithParams) {
   ASSERT_EQ(2, p.fun_defs[1].stmts.size());
 }
 
+TEST(BasicClassTests, ASTArenaNodeHandles) {
+  stringstream in(build_string({
+        "void main() {",
+        "    int x = 1 + 2",
+        "    while (x < 10) { x = x + 1 }",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  ASSERT_EQ(2, p.fun_defs[0].stmts.size());
+  StmtRef s1 = p.fun_defs[0].stmts[0];
+  StmtRef s2 = p.fun_defs[0].stmts[1];
+  ASSERT_EQ(StmtKind::VAR_DECL, s1.kind);
+  ASSERT_EQ(StmtKind::WHILE, s2.kind);
+  Expr& e = p.arena.var_decl_stmts[s1.index].expr;
+  ASSERT_EQ("1", p.arena.first_token(e).lexeme());
+  ASSERT_EQ(2, e.count);
+  ASSERT_EQ("2", p.arena.first_token(p.arena.parts(e)[1].term).lexeme());
+  ASSERT_EQ(1, p.arena.while_stmts.size());
+  ASSERT_EQ(1, p.arena.assign_stmts.size());
+}
+
+TEST(BasicClassTests, ASTHugeFlatExpr) {
+  // deep enough to overflow the stack if expressions were recursive
+  string src = "void main() {\n  int x = 1";
+  for (int i = 0; i < 200000; ++i)
+    src += " + 1";
+  src += "\n  print(x)\n}\n";
+  stringstream in(src);
+  Program p = ASTParser(Lexer(in)).parse();
+  Expr& e = p.arena.var_decl_stmts[p.fun_defs[0].stmts[0].index].expr;
+  ASSERT_EQ(200001, e.count);
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  ASSERT_EQ("200001", out.str());
+  restore_cout();
+}
+
+TEST(BasicClassTests, ASTFlatExprNegation) {
+  stringstream in(build_string({
+        "void main() {",
+        "  bool b = not (1 > 2) and true",
+        "  bool c = true and not true or false",
+        "  print(b)",
+        "  print(c)",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  ASSERT_EQ("truefalse", out.str());
+  restore_cout();
+}
+
+TEST(BasicClassTests, CheckerAnnotatesTypesAndSlots) {
+  stringstream in(build_string({
+        "struct S {int a, double b}",
+        "void main() {",
+        "  if (true) {int x = 1}",
+        "  S s = new S",
+        "  s.b = 2.5",
+        "  double d = s.b * 2.0",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  auto& stmts = p.fun_defs[0].stmts;
+  // s reuses the slot of the if-body's x
+  VarDeclStmt& s_decl = p.arena.var_decl_stmts[stmts[1].index];
+  ASSERT_EQ(0, s_decl.slot);
+  AssignStmt& assign = p.arena.assign_stmts[stmts[2].index];
+  ASSERT_EQ(AccessKind::VAR, assign.lvalue[0].access);
+  ASSERT_EQ(0, assign.lvalue[0].slot);
+  ASSERT_EQ(AccessKind::FIELD, assign.lvalue[1].access);
+  ASSERT_EQ(1, assign.lvalue[1].slot);
+  VarDeclStmt& d_decl = p.arena.var_decl_stmts[stmts[3].index];
+  ASSERT_EQ(1, d_decl.slot);
+  ASSERT_EQ("double", p.arena.parts(d_decl.expr)[0].type.type_name);
+}
+
+TEST(BasicClassTests, TypedCodeGeneration) {
+  stringstream in(build_string({
+        "struct S {int a, double b}",
+        "class C {",
+        "public:",
+        "  int m",
+        "}",
+        "void main() {",
+        "  S s = new S",
+        "  C c = new C",
+        "  s.a = 3",
+        "  c.m = s.a * 2",
+        "  s.b = 1.5 + 1.0",
+        "  if (false) {int x = 0}",
+        "  int y = 4",
+        "  print(c.m < y)",
+        "  print(s.b / 2.0)",
+        "  print(\"a\" < \"b\")",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  string ir = to_string(vm);
+  ASSERT_NE(string::npos, ir.find("SETF_SLOT(0)"));
+  ASSERT_NE(string::npos, ir.find("GETF_SLOT(0)"));
+  ASSERT_NE(string::npos, ir.find("SETF_SLOT(1)"));
+  ASSERT_NE(string::npos, ir.find("SETMEM(m)"));
+  ASSERT_NE(string::npos, ir.find("MUL_INT()"));
+  ASSERT_NE(string::npos, ir.find("ADD_DBL()"));
+  ASSERT_NE(string::npos, ir.find("CMPLT_INT()"));
+  ASSERT_NE(string::npos, ir.find("DIV_DBL()"));
+  // strings are still compared by the generic op
+  ASSERT_NE(string::npos, ir.find("CMPLT()"));
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  ASSERT_EQ("false1.250000true", out.str());
+  restore_cout();
+}
+
+TEST(BasicClassTests, TypedOpOnNullValue) {
+  stringstream in(build_string({
+        "void main() {",
+        "  int x = null",
+        "  int y = x + 1",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  try {
+    vm.run();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("VM Error: null reference", msg.substr(0, 24));
+  }
+}
+
+TEST(BasicClassTests, ASTDefIndexLookups) {
+  stringstream in(build_string({
+        "struct S {int a, double b}",
+        "class C {",
+        "  private:",
+        "    int x",
+        "    int f() {return 1}",
+        "  public:",
+        "    bool y",
+        "    bool g() {return true}",
+        "}",
+        "void main() {}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  const StructDef* s = p.defs.get_struct("S");
+  const ClassDef* c = p.defs.get_class("C");
+  ASSERT_EQ(&p.struct_defs[0], s);
+  ASSERT_EQ(&p.class_defs[0], c);
+  ASSERT_EQ(nullptr, p.defs.get_struct("C"));
+  ASSERT_EQ("double", p.defs.get_field(*s, "b")->data_type.type_name);
+  ASSERT_EQ(nullptr, p.defs.get_field(*s, "c"));
+  ASSERT_NE(nullptr, p.defs.get_member(*c, "x", false));
+  ASSERT_EQ(nullptr, p.defs.get_member(*c, "x", true));
+  ASSERT_NE(nullptr, p.defs.get_method(*c, "g", true));
+  ASSERT_EQ(nullptr, p.defs.get_method(*c, "g", false));
+  ASSERT_NE(nullptr, p.defs.get_function("main"));
+  // class methods are added to the program's functions only once
+  ASSERT_EQ(2, p.fun_defs.size());
+}
+
+TEST(BasicClassTests, ASTLazyFunctionBodies) {
+  stringstream in(build_string({
+        "int used(int x) {",
+        "  if (x > 0) {return x} else {return 0}",
+        "}",
+        "void unused() {",
+        "  int y = z",
+        "}",
+        "void main() {",
+        "  print(used(3))",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in), true).parse();
+  ASSERT_EQ(3, p.fun_defs.size());
+  ASSERT_TRUE(p.fun_defs[0].lazy_body());
+  ASSERT_EQ(0, p.fun_defs[0].stmts.size());
+  // only bodies reachable from main are parsed and checked
+  SemanticChecker t;
+  p.accept(t);
+  ASSERT_FALSE(p.fun_defs[0].lazy_body());
+  ASSERT_EQ(1, p.fun_defs[0].stmts.size());
+  ASSERT_TRUE(p.fun_defs[1].lazy_body());
+  ASSERT_FALSE(p.fun_defs[2].lazy_body());
+  VM vm;
+  CodeGenerator g(vm);
+  p.accept(g);
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  ASSERT_EQ("3", out.str());
+  restore_cout();
+  // syntax errors are still found when pre-parsing
+  stringstream bad("void main() { int x = 1 ");
+  try {
+    ASTParser(Lexer(bad), true).parse();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("Parser Error: ", msg.substr(0, 14));
+  }
+}
+
+TEST(BasicClassTests, LazyCodeGeneration) {
+  stringstream in(build_string({
+        "int called(int x) {return x * 2}",
+        "int not_called(int x) {return x}",
+        "void main() {",
+        "  if (false) {print(not_called(1))}",
+        "  print(called(2))",
+        "  print(called(3))",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker t;
+  p.accept(t);
+  VM vm;
+  CodeGenerator g(vm, true);
+  p.accept(g);
+  string ir = to_string(vm);
+  ASSERT_NE(string::npos, ir.find("Frame 'main' (stub)"));
+  ASSERT_NE(string::npos, ir.find("Frame 'called' (stub)"));
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  restore_cout();
+  ASSERT_EQ("46", out.str());
+  // only the functions actually called were generated
+  ir = to_string(vm);
+  ASSERT_EQ(string::npos, ir.find("Frame 'main' (stub)"));
+  ASSERT_EQ(string::npos, ir.find("Frame 'called' (stub)"));
+  ASSERT_NE(string::npos, ir.find("Frame 'not_called' (stub)"));
+}
+
+TEST(BasicClassTests, TreeShakingRemovesUnreachableDefs) {
+  stringstream in(build_string({
+        "struct Used {int x, Inner in}",
+        "struct Inner {int y}",
+        "struct Unused {int z}",
+        "class C {",
+        "  public:",
+        "    int m() {return helper()}",
+        "}",
+        "class D {",
+        "  public:",
+        "    int n() {return 1}",
+        "}",
+        "int helper() {return 5}",
+        "int dead() {return dead()}",
+        "void main() {",
+        "  Used u = new Used",
+        "  C c = new C",
+        "  print(c.m())",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker t;
+  p.accept(t);
+  TreeShaker shaker;
+  p.accept(shaker);
+  ASSERT_EQ(4, shaker.removed_count());
+  ASSERT_EQ(2, p.struct_defs.size());
+  ASSERT_NE(nullptr, p.defs.get_struct("Inner"));
+  ASSERT_EQ(nullptr, p.defs.get_struct("Unused"));
+  ASSERT_EQ(1, p.class_defs.size());
+  ASSERT_EQ("C", p.class_defs[0].class_name.lexeme());
+  ASSERT_EQ(3, p.fun_defs.size());
+  ASSERT_NE(nullptr, p.defs.get_function("m"));
+  ASSERT_NE(nullptr, p.defs.get_function("helper"));
+  ASSERT_EQ(nullptr, p.defs.get_function("dead"));
+  ASSERT_EQ(nullptr, p.defs.get_function("n"));
+}
+
+TEST(BasicClassTests, ParallelCheckAndCodeGen) {
+  vector<string> lines;
+  for (int i = 0; i < 40; ++i) {
+    string n = to_string(i);
+    lines.push_back("int f" + n + "(int x) {");
+    lines.push_back("  int y = x * " + n);
+    lines.push_back("  while (y > 10) {y = y - 3}");
+    lines.push_back("  return y");
+    lines.push_back("}");
+  }
+  lines.push_back("void main() {print(f7(5))}");
+  string src = "";
+  for (string& line : lines)
+    src += line + "\n";
+  // same frames as the sequential generator
+  stringstream in1(src);
+  Program p1 = ASTParser(Lexer(in1)).parse();
+  SemanticChecker t1;
+  p1.accept(t1);
+  VM vm1;
+  CodeGenerator g1(vm1);
+  p1.accept(g1);
+  stringstream in2(src);
+  Program p2 = ASTParser(Lexer(in2)).parse();
+  SemanticChecker t2(4);
+  p2.accept(t2);
+  VM vm2;
+  CodeGenerator g2(vm2, false, 4);
+  p2.accept(g2);
+  ASSERT_EQ(to_string(vm1), to_string(vm2));
+  // the error of the first function in source order is reported
+  stringstream in3(src + "int g1() {return true}\nint g2() {return z}\n");
+  Program p3 = ASTParser(Lexer(in3)).parse();
+  try {
+    SemanticChecker t3(4);
+    p3.accept(t3);
+    FAIL();
+  } catch (MyPLException& ex) {
+    string msg = ex.what();
+    ASSERT_NE(string::npos, msg.find("line 202"));
+  }
+}
+
 
 
 //----------------------------------------------------------------------
@@ -737,6 +1168,48 @@ TEST(BasicClassTests, OneFieldCLassAlloc) {
   restore_cout();
 }
 
+TEST(BasicClassTests, StructFieldErrors) {
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::ALLOCS("S"));
+  main.instructions.push_back(VMInstr::STORE(0));     // x = oid
+  main.instructions.push_back(VMInstr::LOAD(0));
+  main.instructions.push_back(VMInstr::ADDF("a"));
+  main.instructions.push_back(VMInstr::LOAD(0));
+  main.instructions.push_back(VMInstr::PUSH(3));
+  main.instructions.push_back(VMInstr::SETF("a"));
+  main.instructions.push_back(VMInstr::LOAD(0));
+  main.instructions.push_back(VMInstr::GETF("a"));
+  main.instructions.push_back(VMInstr::WRITE());
+  main.instructions.push_back(VMInstr::LOAD(0));
+  main.instructions.push_back(VMInstr::GETF("b"));
+  VM vm;
+  vm.add(main);
+  stringstream out;
+  change_cout(out);
+  try {
+    vm.run();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("VM Error: invalid field 'b'", msg.substr(0, 27));
+  }
+  restore_cout();
+  EXPECT_EQ("3", out.str());
+  // an object id that is not a struct
+  VMFrameInfo bad {"main", 0};
+  bad.instructions.push_back(VMInstr::PUSH(1));
+  bad.instructions.push_back(VMInstr::GETF_SLOT(0));
+  VM bad_vm;
+  bad_vm.add(bad);
+  try {
+    bad_vm.run();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("VM Error: invalid struct object id 1", msg.substr(0, 36));
+  }
+}
+
 TEST(BasicClassTests, OneMemberTwoClassAlloc) {
   VMFrameInfo main {"main", 0};                      
   main.instructions.push_back(VMInstr::ALLOCC());
@@ -863,6 +1336,612 @@ TEST(BasicClassTests, SimpleMethodCalls) {
   restore_cout();
 }  
 
+TEST(BasicClassTests, VerifierSizesFrame) {
+  VMFrameInfo f {"f", 1};
+  f.instructions.push_back(VMInstr::STORE(0));      // x = arg
+  f.instructions.push_back(VMInstr::LOAD(0));       // 1: while x < 3
+  f.instructions.push_back(VMInstr::PUSH(3));
+  f.instructions.push_back(VMInstr::CMPLT_INT());
+  f.instructions.push_back(VMInstr::JMPF(10));
+  f.instructions.push_back(VMInstr::LOAD(0));       //   x = x + 1
+  f.instructions.push_back(VMInstr::PUSH(1));
+  f.instructions.push_back(VMInstr::ADD_INT());
+  f.instructions.push_back(VMInstr::STORE(1));
+  f.instructions.push_back(VMInstr::JMP(1));
+  f.instructions.push_back(VMInstr::LOAD(1));       // 10: return
+  f.instructions.push_back(VMInstr::RET());
+  VMVerifier verifier;
+  verifier.verify(f, [](const string& name) {return -1;});
+  ASSERT_TRUE(f.is_verified);
+  ASSERT_EQ(2, f.local_count);
+  ASSERT_EQ(2, f.max_stack);
+  ASSERT_EQ(0, verifier.stack_depth(1));
+  ASSERT_EQ(2, verifier.stack_depth(3));
+  using T = VMVerifier::ValueType;
+  ASSERT_EQ(vector<T>({T::ANY, T::INT}), verifier.stack_types(3).value());
+  ASSERT_EQ(vector<T>({T::BOOL}), verifier.stack_types(4).value());
+}
+
+TEST(BasicClassTests, VerifierRejectsMalformedCode) {
+  auto rejects = [](vector<VMInstr> instrs) {
+    VMFrameInfo f {"main", 0, instrs};
+    try {
+      VMVerifier().verify(f, [](const string& name) {return -1;});
+      return false;
+    } catch (MyPLException& e) {
+      return string(e.what()).substr(0, 9) == "VM Error:";
+    }
+  };
+  // stack underflow
+  ASSERT_TRUE(rejects({VMInstr::PUSH(1), VMInstr::ADD()}));
+  // depths differ where the branches join
+  ASSERT_TRUE(rejects({VMInstr::PUSH(true), VMInstr::JMPF(3),
+                       VMInstr::PUSH(1), VMInstr::NOP()}));
+  // jump out of the frame
+  ASSERT_TRUE(rejects({VMInstr::JMP(5)}));
+  // load of a variable never stored
+  ASSERT_TRUE(rejects({VMInstr::LOAD(0), VMInstr::WRITE()}));
+  // call to an undefined function
+  ASSERT_TRUE(rejects({VMInstr::CALL("f")}));
+  // typed op on a value of another type
+  ASSERT_TRUE(rejects({VMInstr::PUSH(1.5), VMInstr::PUSH(1),
+                       VMInstr::ADD_INT()}));
+  ASSERT_TRUE(rejects({VMInstr::PUSH(1), VMInstr::JMPF(0)}));
+  // but not null (checked when run)
+  ASSERT_FALSE(rejects({VMInstr::PUSH(nullptr), VMInstr::PUSH(1),
+                        VMInstr::ADD_INT(), VMInstr::POP()}));
+  // the vm verifies frames before running them
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::POP());
+  VM vm;
+  vm.add(main);
+  try {
+    vm.run();
+    FAIL();
+  } catch (MyPLException& e) {
+    string msg = e.what();
+    ASSERT_EQ("VM Error: operand stack underflow", msg.substr(0, 33));
+  }
+}
+
+TEST(BasicClassTests, GeneratedLoopsKeepStackBalanced) {
+  stringstream in(build_string({
+        "int f(int x) {return x}",
+        "void main() {",
+        "  int s = 0",
+        "  for (int i = 0; i < 3; i = i + 1) {",
+        "    s = s + i",
+        "    f(i)",
+        "    to_string(i)",
+        "  }",
+        "  print(s)",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  stringstream out;
+  change_cout(out);
+  vm.run();
+  restore_cout();
+  ASSERT_EQ("3", out.str());
+}
+
+TEST(BasicClassTests, TraceAndStepFilters) {
+  VMFrameInfo f {"f", 1};
+  f.instructions.push_back(VMInstr::PUSH(1));
+  f.instructions.push_back(VMInstr::ADD_INT());
+  f.instructions.push_back(VMInstr::RET());
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::PUSH(2));
+  main.instructions.push_back(VMInstr::CALL("f"));
+  main.instructions.push_back(VMInstr::WRITE());
+  VM vm;
+  vm.add(f);
+  vm.add(main);
+  // only f's instructions from pc 1 are traced
+  vm.set_trace_filter("f", 1);
+  stringstream out, err;
+  change_cout(out);
+  streambuf* err_buffer = cerr.rdbuf(err.rdbuf());
+  vm.run(RunMode::TRACE);
+  cerr.rdbuf(err_buffer);
+  restore_cout();
+  ASSERT_EQ("3", out.str());
+  string trace = err.str();
+  ASSERT_EQ(string::npos, trace.find("FRAME.........: main"));
+  ASSERT_EQ(string::npos, trace.find("PC............: 0"));
+  ASSERT_NE(string::npos, trace.find("INSTR.........: ADD_INT()"));
+  ASSERT_NE(string::npos, trace.find("INSTR.........: RET()"));
+  // stepping stops at the filtered pcs of any function
+  vm.set_trace_filter("", 1, 1);
+  vector<string> steps;
+  vm.set_step_handler([&](const VMFrame& frame) {
+    steps.push_back(frame.info.function_name + ":" + to_string(frame.pc));
+  });
+  change_cout(out);
+  vm.run(RunMode::STEP);
+  restore_cout();
+  ASSERT_EQ(vector<string>({"main:1", "f:1"}), steps);
+}
+
+TEST(BasicClassTests, ProfilerGetsRunEvents) {
+  struct Counts : VMProfiler {
+    int instructions = 0;
+    vector<string> events;
+    void instruction(const VMFrame& frame, const VMInstr& instr) {
+      ++instructions;
+    }
+    void call(const VMFrame& caller, const VMFrame& callee) {
+      events.push_back(caller.info.function_name + "->" +
+                       callee.info.function_name);
+    }
+    void ret(const VMFrame& frame) {
+      events.push_back("ret " + frame.info.function_name);
+    }
+  };
+  VMFrameInfo f {"f", 0};
+  f.instructions.push_back(VMInstr::PUSH(nullptr));
+  f.instructions.push_back(VMInstr::RET());
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::CALL("f"));
+  main.instructions.push_back(VMInstr::POP());
+  VM vm;
+  vm.add(f);
+  vm.add(main);
+  Counts counts;
+  vm.add_profiler(counts);
+  // profilers only see profiled runs
+  vm.run(RunMode::PLAIN);
+  ASSERT_EQ(0, counts.instructions);
+  vm.run();
+  ASSERT_EQ(4, counts.instructions);
+  ASSERT_EQ(vector<string>({"main->f", "ret f"}), counts.events);
+}
+
+TEST(BasicClassTests, RunStatsCountPhasesAndExecution) {
+  stringstream in(build_string({
+        "struct T {int x}",
+        "int f(int n) {",
+        "  if (n == 0) {return 0}",
+        "  return f(n - 1)",
+        "}",
+        "void main() {",
+        "  T t = new T",
+        "  array int xs = new int[3]",
+        "  f(2)",
+        "}"
+      }));
+  RunStats stats;
+  Program p;
+  stats.phase("parse", [&]() {p = ASTParser(Lexer(in)).parse();});
+  ASSERT_EQ(1, stats.phases.size());
+  ASSERT_EQ("parse", stats.phases[0].name);
+  ASSERT_LT(0, stats.phases[0].allocations);
+  ASSERT_LT(0, stats.phases[0].allocated_bytes);
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  vm.add_profiler(stats.vm);
+  vm.run();
+  ASSERT_LT(0, stats.vm.instructions);
+  ASSERT_EQ(3, stats.vm.calls);
+  ASSERT_EQ(4, stats.vm.max_call_depth);
+  ASSERT_EQ(1, stats.vm.struct_objects);
+  ASSERT_EQ(1, stats.vm.array_objects);
+  ASSERT_EQ(0, stats.vm.class_objects);
+  ASSERT_EQ(2, stats.vm.peak_heap_objects());
+  stats.vm.measure_heap(vm);
+  ASSERT_LT(0, stats.vm.peak_heap_bytes);
+  // allocations are only counted in phases
+  long count = allocation_count();
+  vector<int> unused(100);
+  ASSERT_EQ(count, allocation_count());
+  stringstream json;
+  stats.print_json(json);
+  ASSERT_NE(string::npos, json.str().find("\"name\": \"parse\""));
+  ASSERT_NE(string::npos, json.str().find("\"calls\": 3,"));
+  ASSERT_NE(string::npos, json.str().find("\"array\": 1"));
+}
+
+TEST(BasicClassTests, OpcodeProfilerCountsSequences) {
+  VMFrameInfo f {"f", 0};
+  f.instructions.push_back(VMInstr::PUSH(1));
+  f.instructions.push_back(VMInstr::RET());
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::PUSH(0));       // i = 0
+  main.instructions.push_back(VMInstr::STORE(0));
+  main.instructions.push_back(VMInstr::LOAD(0));       // 2: while i < 3
+  main.instructions.push_back(VMInstr::PUSH(3));
+  main.instructions.push_back(VMInstr::CMPLT_INT());
+  main.instructions.push_back(VMInstr::JMPF(12));
+  main.instructions.push_back(VMInstr::LOAD(0));       //   i = i + f()
+  main.instructions.push_back(VMInstr::CALL("f"));
+  main.instructions.push_back(VMInstr::ADD_INT());
+  main.instructions.push_back(VMInstr::STORE(0));
+  main.instructions.push_back(VMInstr::JMP(2));
+  main.instructions.push_back(VMInstr::NOP());
+  main.instructions.push_back(VMInstr::NOP());         // 12
+  VM vm;
+  vm.add(f);
+  vm.add(main);
+  OpcodeProfiler profiler;
+  vm.add_profiler(profiler);
+  vm.run();
+  ASSERT_EQ(7, profiler.count(OpCode::LOAD));
+  ASSERT_EQ(3, profiler.count(OpCode::CALL));
+  ASSERT_EQ(3, profiler.count(OpCode::RET));
+  ASSERT_EQ(1, profiler.count(OpCode::NOP));
+  ASSERT_EQ(0, profiler.count(OpCode::ADD));
+  ASSERT_LT(0, profiler.ticks(OpCode::CALL));
+  // the loop test pairs run 4 times (ties in opcode order)
+  auto pairs = profiler.top_sequences(2, 3);
+  ASSERT_EQ(3, pairs.size());
+  ASSERT_EQ(vector<OpCode>({OpCode::PUSH, OpCode::CMPLT_INT}), pairs[0].first);
+  ASSERT_EQ(vector<OpCode>({OpCode::LOAD, OpCode::PUSH}), pairs[1].first);
+  ASSERT_EQ(4, pairs[2].second);
+  // sequences stop at calls and returns (so LOAD CALL ADD_INT is not
+  // a triple)
+  for (auto& [ops, n] : profiler.top_sequences(3, 100))
+    ASSERT_NE(OpCode::CALL, ops[1]);
+  stringstream out;
+  profiler.print(out);
+  ASSERT_NE(string::npos, out.str().find("top opcode triples:"));
+}
+
+TEST(BasicClassTests, SamplerFoldsCallStacks) {
+  VMFrameInfo g {"g", 0};
+  g.instructions.push_back(VMInstr::PUSH(nullptr));
+  g.instructions.push_back(VMInstr::RET());
+  VMFrameInfo f {"f", 0};
+  f.instructions.push_back(VMInstr::CALL("g"));
+  f.instructions.push_back(VMInstr::RET());
+  VMFrameInfo main {"main", 0};
+  main.instructions.push_back(VMInstr::CALL("f"));
+  main.instructions.push_back(VMInstr::POP());
+  main.instructions.push_back(VMInstr::CALL("g"));
+  main.instructions.push_back(VMInstr::POP());
+  VM vm;
+  vm.add(g);
+  vm.add(f);
+  vm.add(main);
+  // sample every instruction
+  StackSampler sampler(StackSampler::Trigger::INSTRUCTIONS, 1);
+  vm.set_sampler(sampler);
+  vm.run();
+  ASSERT_EQ(10, sampler.sample_count());
+  ASSERT_EQ(4, sampler.stacks().at("main"));
+  ASSERT_EQ(2, sampler.stacks().at("main;f"));
+  ASSERT_EQ(2, sampler.stacks().at("main;f;g"));
+  ASSERT_EQ(2, sampler.stacks().at("main;g"));
+  stringstream out;
+  sampler.write_folded(out);
+  ASSERT_EQ(build_string({"main 4", "main;f 2", "main;f;g 2", "main;g 2"}),
+            out.str());
+  // with pcs (callers are at their calls), every third instruction
+  StackSampler pc_sampler(StackSampler::Trigger::INSTRUCTIONS, 3, true);
+  vm.set_sampler(pc_sampler);
+  vm.run();
+  ASSERT_EQ(3, pc_sampler.sample_count());
+  ASSERT_EQ(1, pc_sampler.stacks().at("main@0;f@0;g@0"));
+  ASSERT_EQ(1, pc_sampler.stacks().at("main@1"));
+  ASSERT_EQ(1, pc_sampler.stacks().at("main@2;g@1"));
+}
+
+TEST(BasicClassTests, LineTablesMapCodeToSource) {
+  stringstream in(build_string({
+        "void main() {",
+        "  int s = 0",
+        "  for (int i = 0; i < 4; i = i + 1) {",
+        "    s = s + i",
+        "  }",
+        "  array int xs = new int[2]",
+        "  xs[s] = 1",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  LineProfiler profiler;
+  vm.add_profiler(profiler);
+  try {
+    vm.run();
+    FAIL();
+  } catch (MyPLException& e) {
+    // run time errors point at the source
+    string msg = e.what();
+    ASSERT_NE(string::npos, msg.find("out-of-bounds array index"));
+    ASSERT_NE(string::npos, msg.find("near line 7, column 3"));
+  }
+  ASSERT_EQ(0, profiler.count(0));
+  ASSERT_EQ(0, profiler.count(1));
+  ASSERT_EQ(2, profiler.count(2));                      // PUSH STORE
+  ASSERT_EQ(4 * 4, profiler.count(4));                  // LOAD LOAD ADD STORE
+  ASSERT_EQ(0, profiler.count(5));
+  stringstream out;
+  profiler.print(out, in.str());
+  ASSERT_NE(string::npos, out.str().find("   4      s = s + i\n"));
+}
+
+TEST(BasicClassTests, CallProfilerCountsCallsAndTimes) {
+  stringstream in(build_string({
+        "int fact(int n) {",
+        "  if (n <= 1) {return 1}",
+        "  return n * fact(n - 1)",
+        "}",
+        "int id(int x) {return x}",
+        "void main() {",
+        "  int s = 0",
+        "  for (int i = 0; i < 3; i = i + 1) {",
+        "    s = s + id(i) + fact(4)",
+        "  }",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  CallProfiler profiler;
+  vm.add_profiler(profiler);
+  vm.run();
+  auto& functions = profiler.functions();
+  ASSERT_EQ(3, functions.size());
+  const auto& main = functions.at("main");
+  const auto& fact = functions.at("fact");
+  const auto& id = functions.at("id");
+  ASSERT_EQ(1, main.calls);
+  ASSERT_EQ(3, id.calls);
+  ASSERT_EQ(12, fact.calls);
+  ASSERT_EQ(1, main.max_depth);
+  ASSERT_EQ(1, id.max_depth);
+  ASSERT_EQ(4, fact.max_depth);
+  // lines of the functions' first code (main's is its first statement)
+  ASSERT_EQ(1, fact.line);
+  ASSERT_EQ(7, main.line);
+  // main's time includes everything once
+  ASSERT_EQ(main.inclusive, main.exclusive + id.inclusive + fact.inclusive);
+  ASSERT_LE(fact.exclusive, fact.inclusive);
+  auto& edges = profiler.edges();
+  ASSERT_EQ(3, edges.at({"main", "id"}).calls);
+  ASSERT_EQ(3, edges.at({"main", "fact"}).calls);
+  ASSERT_EQ(9, edges.at({"fact", "fact"}).calls);
+  ASSERT_LE(edges.at({"fact", "fact"}).inclusive, fact.inclusive);
+  ASSERT_EQ(fact.inclusive, edges.at({"main", "fact"}).inclusive);
+  ASSERT_EQ(9, edges.at({"main", "fact"}).line);
+  stringstream out;
+  profiler.write_callgrind(out, "fact.mypl");
+  ASSERT_NE(string::npos, out.str().find("fl=fact.mypl\nfn=fact\n"));
+  ASSERT_NE(string::npos, out.str().find("cfn=fact\ncalls=9 1\n3 "));
+}
+
+TEST(BasicClassTests, TraceEventsCoverCodegenAndCalls) {
+  stringstream in(build_string({
+        "struct T {int x}",
+        "void f() {",
+        "  T t = new T",
+        "}",
+        "void main() {",
+        "  for (int i = 0; i < 3; i = i + 1) {",
+        "    f()",
+        "  }",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  TraceEvents events;
+  VM vm;
+  CodeGenerator generator(vm);
+  generator.set_trace(events);
+  p.accept(generator);
+  ASSERT_EQ(2, events.size());
+  // every call is traced with no minimum duration
+  TraceProfiler profiler(events, 0);
+  vm.add_profiler(profiler);
+  vm.run();
+  // 4 calls, heap counts at 1 and 2 objects, and the final count
+  ASSERT_EQ(2 + 4 + 3, events.size());
+  stringstream out;
+  events.write(out);
+  string json = out.str();
+  ASSERT_EQ("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", json.substr(0, 42));
+  ASSERT_NE(string::npos, json.find("{\"name\": \"f\", \"cat\": \"codegen\", \"ph\": \"X\""));
+  ASSERT_NE(string::npos, json.find("{\"name\": \"main\", \"cat\": \"vm\", \"ph\": \"X\""));
+  ASSERT_NE(string::npos, json.find("\"args\": {\"objects\": 3}"));
+  // short calls are left out
+  TraceEvents few;
+  TraceProfiler slow_only(few, 1e9);
+  VM vm2;
+  CodeGenerator generator2(vm2);
+  p.accept(generator2);
+  vm2.add_profiler(slow_only);
+  vm2.run();
+  ASSERT_EQ(3, few.size());
+}
+
+TEST(BasicClassTests, HeapStatsCountObjectsByType) {
+  stringstream in(build_string({
+        "struct Node {int val, Node next}",
+        "class Box {",
+        "  public:",
+        "    int x",
+        "}",
+        "void main() {",
+        "  Node n1 = new Node",
+        "  Node n2 = new Node",
+        "  n1.next = n2",
+        "  Box b = new Box",
+        "  array int xs = new int[10]",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  vm.run();
+  vector<VMHeapStats> stats = vm.heap_stats();
+  ASSERT_EQ(3, stats.size());
+  // one type per heap (arrays are untyped)
+  map<string, VMHeapStats> by_heap;
+  for (auto& entry : stats) {
+    ASSERT_GT(entry.bytes, 0);
+    by_heap[entry.heap] = entry;
+  }
+  ASSERT_EQ("Node", by_heap["struct"].type);
+  ASSERT_EQ(2, by_heap["struct"].objects);
+  ASSERT_EQ("Box", by_heap["class"].type);
+  ASSERT_EQ(1, by_heap["class"].objects);
+  ASSERT_EQ("", by_heap["array"].type);
+  ASSERT_EQ(1, by_heap["array"].objects);
+  // largest first
+  for (int i = 1; i < stats.size(); ++i)
+    ASSERT_GE(stats[i - 1].bytes, stats[i].bytes);
+  // the first node refers to the second
+  stringstream out;
+  vm.write_heap_snapshot(out);
+  string json = out.str();
+  ASSERT_EQ("{\"objects\": [", json.substr(0, 13));
+  ASSERT_NE(string::npos, json.find("{\"id\": 2023, \"heap\": \"struct\", \"type\": \"Node\""));
+  ASSERT_NE(string::npos, json.find("\"refs\": [{\"field\": \"next\", \"to\": 2024}]"));
+  ASSERT_NE(string::npos, json.find("\"type\": \"Box\""));
+  // main's variables at its return are the roots
+  ASSERT_NE(string::npos, json.find("{\"frame\": \"main\", \"slot\": 0, \"to\": 2023}"));
+  ASSERT_EQ(string::npos, json.find("\"roots\": [\n]"));
+}
+
+TEST(BasicClassTests, AllocationProfilerCountsSites) {
+  stringstream in(build_string({
+        "struct Node {int val, Node next}",
+        "Node push(Node head, int val) {",
+        "  Node n = new Node",
+        "  n.val = val",
+        "  n.next = head",
+        "  return n",
+        "}",
+        "void main() {",
+        "  Node head = null",
+        "  for (int i = 0; i < 5; i = i + 1) {",
+        "    head = push(head, i)",
+        "    array int tmp = new int[3]",
+        "  }",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  AllocationProfiler profiler;
+  vm.add_profiler(profiler);
+  vm.run();
+  vector<AllocationProfiler::Site> sites = profiler.sites(vm);
+  ASSERT_EQ(2, sites.size());
+  map<OpCode, AllocationProfiler::Site> by_op;
+  for (auto& site : sites)
+    by_op[site.opcode] = site;
+  AllocationProfiler::Site& nodes = by_op[OpCode::ALLOCS];
+  ASSERT_EQ("push", nodes.function);
+  ASSERT_EQ(3, nodes.line);
+  ASSERT_EQ(5, nodes.count);
+  ASSERT_GT(nodes.bytes, 0);
+  // the list is reachable from main's head variable
+  ASSERT_EQ(5, nodes.live);
+  ASSERT_EQ(nodes.bytes, nodes.live_bytes);
+  // only the last temp array is still in a variable
+  AllocationProfiler::Site& arrays = by_op[OpCode::ALLOCA];
+  ASSERT_EQ("main", arrays.function);
+  ASSERT_EQ(12, arrays.line);
+  ASSERT_EQ(5, arrays.count);
+  ASSERT_EQ(1, arrays.live);
+  stringstream out;
+  profiler.print(out, vm);
+  ASSERT_NE(string::npos, out.str().find("push@"));
+}
+
+TEST(BasicClassTests, FlightRecorderKeepsLastEvents) {
+  stringstream in(build_string({
+        "struct T {int x}",
+        "int f(T t) {",
+        "  return t.x",
+        "}",
+        "void main() {",
+        "  T t = new T",
+        "  t.x = 1",
+        "  int y = f(t)",
+        "  t = null",
+        "  y = f(t)",
+        "}"
+      }));
+  Program p = ASTParser(Lexer(in)).parse();
+  SemanticChecker checker;
+  p.accept(checker);
+  VM vm;
+  CodeGenerator generator(vm);
+  p.accept(generator);
+  try {
+    vm.run();
+    FAIL();
+  } catch (MyPLException& ex) {
+  }
+  const FlightRecorder& recorder = vm.flight_recorder();
+  ASSERT_EQ(64, recorder.capacity());
+  vector<FlightRecorder::Entry> events = recorder.recent();
+  ASSERT_EQ(recorder.count(), events.size());
+  // the failing GETF follows the second call of f
+  FlightRecorder::Entry last = events.back();
+  ASSERT_EQ("f", last.function->function_name);
+  ASSERT_EQ(OpCode::GETF_SLOT, last.opcode);
+  int calls = 0;
+  int returns = 0;
+  for (auto& e : events) {
+    if (e.event == FlightRecorder::Event::CALL) {
+      ++calls;
+      ASSERT_EQ("f", e.function->function_name);
+    }
+    if (e.event == FlightRecorder::Event::RETURN) {
+      ++returns;
+      ASSERT_EQ("main", e.function->function_name);
+    }
+  }
+  ASSERT_EQ(2, calls);
+  ASSERT_EQ(1, returns);
+  stringstream out;
+  recorder.write(out);
+  ASSERT_NE(string::npos, out.str().find("  -> f\n"));
+  ASSERT_NE(string::npos, out.str().find("  <- main@"));
+  // only the last events are kept
+  vm.flight_recorder().resize(5);
+  ASSERT_EQ(8, recorder.capacity());
+  ASSERT_THROW(vm.run(), MyPLException);
+  events = recorder.recent();
+  ASSERT_EQ(8, events.size());
+  ASSERT_GT(recorder.count(), 8);
+  ASSERT_EQ(OpCode::GETF_SLOT, events.back().opcode);
+  // every mypl run mode prints the events on an error, such as a
+  // profiled run of --stats
+  RunStats stats;
+  vm.add_profiler(stats.vm);
+  stringstream err;
+  ASSERT_THROW(stats.phase("execution", [&]() {
+    vm.flight_recorder().watch([&]() {vm.run();}, err);
+  }), MyPLException);
+  ASSERT_NE(string::npos, err.str().find("last 8 of "));
+  ASSERT_NE(string::npos, err.str().find(" GETF_SLOT\n"));
+}
+
 //----------------------------------------------------------------------
 // main
 //----------------------------------------------------------------------